@@ -2,8 +2,7 @@
 
 #include <assert.h>
 #include <stdio.h>
-#include <hal.h>         /* Intel: LX7 infrastructure */
-#include <test_defrag.h> /* Intel : libmctop integrationm test */
+#include <hal.h> /* Intel: LX7 infrastructure */
 #include <hal_msgq.h>
 
 #include "libmctp.h"
@@ -13,42 +12,40 @@
 #include "config.h"
 #endif
 
-uintptr_t mcp_alloc_msg_andle     = 0;
-uintptr_t mcp_alloc_context_andle = 0;
-
-/* internal-only allocation functions */
-void inline *__mctp_alloc(size_t size)
+/* General purpose allocations, for the bindings state and the tests. The
+ * core itself allocates through the struct mctp_alloc_ops of its instance.
+ * Without MCTP_DEFAULT_ALLOC the application provides these two. */
+#ifdef MCTP_DEFAULT_ALLOC
+void *__mctp_alloc(size_t size)
 {
-    /* Use Q */
-    return msgq_request(mcp_alloc_msg_andle, size);
+    return malloc(size);
 }
 
-void inline __mctp_free(void *ptr)
+void __mctp_free(void *ptr)
 {
-    /* Use Q !*/
-    msgq_release(mcp_alloc_msg_andle, ptr);
+    free(ptr);
 }
+#endif
 
-/* internal-only allocation functions */
-void inline *__mctp_alloc_context(size_t size)
+/* Default allocator: a message queue per pool. The memory is never returned */
+static uintptr_t mctp_msgq_pool_create(void *data, size_t item_size, size_t count)
 {
-    /* Use Q */
-    return msgq_request(mcp_alloc_context_andle, size);
+    return msgq_create(item_size, count);
 }
 
-void inline __mctp_free_context(void *ptr)
+static void *mctp_msgq_pool_alloc(void *data, uintptr_t pool)
 {
-    /* Use Q !*/
-    msgq_release(mcp_alloc_context_andle, ptr);
+    return msgq_request(pool, 0);
 }
 
-int __mctp_mem_init(void)
+static void mctp_msgq_pool_free(void *data, uintptr_t pool, void *ptr)
 {
-    mcp_alloc_msg_andle     = test_defrag_mctplib_get_handle(0);
-    mcp_alloc_context_andle = test_defrag_mctplib_get_handle(1);
-
-    if ( mcp_alloc_msg_andle && mcp_alloc_context_andle )
-        return 0;
-
-    return 1;
+    msgq_release(pool, ptr);
 }
+
+const struct mctp_alloc_ops mctp_default_alloc_ops = {
+    .pool_create = mctp_msgq_pool_create,
+    .pkt_alloc   = mctp_msgq_pool_alloc,
+    .ctx_alloc   = mctp_msgq_pool_alloc,
+    .free        = mctp_msgq_pool_free,
+};
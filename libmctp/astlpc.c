@@ -146,11 +146,12 @@ struct mctp_binding_astlpc
 
 #define binding_to_astlpc(b) container_of(b, struct mctp_binding_astlpc, binding)
 
-#define astlpc_prlog(ctx, lvl, fmt, ...)                                            \
-    do                                                                              \
-    {                                                                               \
-        bool __bmc = ((ctx)->mode == MCTP_BINDING_ASTLPC_MODE_BMC);                 \
-        mctp_prlog(lvl, pr_fmt("%s: " fmt), __bmc ? "bmc" : "host", ##__VA_ARGS__); \
+/* Through mctp_prlog_at(), for the MCTP_LOG_LEVEL filter and the binary log */
+#define astlpc_prlog(ctx, lvl, fmt, ...)                                               \
+    do                                                                                 \
+    {                                                                                  \
+        bool __bmc = ((ctx)->mode == MCTP_BINDING_ASTLPC_MODE_BMC);                    \
+        mctp_prlog_at(lvl, pr_fmt("%s: " fmt), __bmc ? "bmc" : "host", ##__VA_ARGS__); \
     } while ( 0 )
 
 #define astlpc_prerr(ctx, fmt, ...)    astlpc_prlog(ctx, MCTP_LOG_ERR, fmt, ##__VA_ARGS__)
@@ -9,8 +9,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <hal.h>         /* Intel: LX7 infrastructure */
-#include <test_defrag.h> /* Intel : libmctop integrationm test */
+#include <hal.h> /* Intel: LX7 infrastructure */
 
 #undef pr_fmt
 #define pr_fmt(fmt) "libMCTP: " fmt
@@ -20,6 +19,7 @@
 #include "libmctp-log.h"
 #include "libmctp-cmds.h"
 #include "range.h"
+#include "crc32c.h"
 
 /* Internal data structures */
 
@@ -38,47 +38,143 @@ struct mctp_bus
 
     struct mctp_pktbuf *tx_queue_head;
     struct mctp_pktbuf *tx_queue_tail;
+    size_t              tx_queue_len;
+};
 
-    /* todo: routing */
+/* Handler of a streamed message type, free while 'fn' is NULL */
+struct mctp_rx_stream
+{
+    uint8_t           type;
+    mctp_rx_stream_fn fn;
+    void             *data;
 };
 
 struct mctp_msg_ctx
 {
-    uint8_t  src;
-    uint8_t  dest;
-    uint8_t  tag;
-    uint8_t  last_seq;
-    void    *buf;
-    uint8_t *p_cur;
-    size_t   free_bytes;
-    size_t   buf_size;
-    size_t   buf_alloc_size;
-    size_t   fragment_size;
+    uint8_t             src;
+    uint8_t             dest;
+    uint8_t             tag;
+    uint8_t             last_seq;
+    void               *buf;
+    uint8_t            *p_cur;
+    size_t              free_bytes;
+    size_t              buf_size;
+    size_t              buf_alloc_size;
+    void               *rx_buf; /* Application buffer holding 'buf', if provided */
+    size_t              fragment_size;
+    uint32_t            ic_crc;  /* Integrity check over the first 'ic_done' bytes */
+    size_t              ic_done; /* Bytes of 'buf' already in 'ic_crc' */
+    bool                scatter; /* Packets are kept in 'pkts' rather than copied to 'buf' */
+    struct mctp_pktbuf *pkts;    /* Kept packets, linked through 'next' */
+    struct mctp_pktbuf *pkts_tail;
+    uint32_t            deadline; /* Wheel tick at which reassembly is abandoned */
+    const struct mctp_rx_stream *stream; /* Handler the message is streamed to, no buffer nor packets kept */
+    bool                tag_owner;     /* Streamed: tag owner flag of the message */
+    bool                ic;            /* The message carries an integrity check we verify */
+    uint8_t             ic_carry_len;  /* Streamed: bytes held back in 'ic_carry' */
+    uint8_t             ic_carry[MCTP_MSG_IC_SIZE]; /* Streamed: last bytes seen, the trailer once the message is complete */
+};
+
+struct mctp_req
+{
+    mctp_eid_t   eid;
+    uint8_t      tag;
+    uint32_t     deadline; /* Wheel tick at which the response is given up */
+    mctp_resp_fn fn;
+    void        *data;
+};
+
+/* Responses of the built-in control responder */
+enum mctp_ctrl_tmpl_id
+{
+    MCTP_CTRL_TMPL_EID,
+    MCTP_CTRL_TMPL_UUID,
+    MCTP_CTRL_TMPL_VERSION,
+    MCTP_CTRL_TMPL_TYPES,
+    MCTP_CTRL_TMPL_COUNT,
+};
+
+struct mctp_ctrl_tmpl
+{
+    uint8_t len; /* 0 when the command is left to the application */
+    uint8_t msg[sizeof(struct mctp_ctrl_msg_hdr) + 2 + MCTP_CTRL_MSG_TYPES_MAX];
 };
 
 struct mctp
 {
-    int              n_busses;
-    struct mctp_bus *busses;
+    int             n_busses; /* Slots used in 'busses', free ones have no binding */
+    struct mctp_bus busses[MCTP_MAX_BUSSES];
+
+    /* Bus index per destination EID, so routing a message is a single
+     * load. Unset entries hold 0, the first bus being the default route.
+     * 'routes_set' flags the EIDs with an explicit route. */
+    uint8_t  routes[256];
+    uint32_t routes_set[256 / 32];
 
     /* Message RX callback */
     mctp_rx_fn message_rx;
     void      *message_rx_data;
 
-    /* Packet capture callback */
-    mctp_capture_fn capture;
-    void           *capture_data;
-
-    /* Message reassembly.
-	 * @todo: flexible context count
-	 */
-    struct mctp_msg_ctx msg_ctxs[1];
+    /* Scattered message RX callback */
+    mctp_rx_pkts_fn message_rx_pkts;
+    void           *message_rx_pkts_data;
+
+    /* Streamed message types: flagged in 'rx_stream_types', so the other
+     * messages pay a single load, with their handler in 'rx_streams' */
+    uint32_t              rx_stream_types[256 / 32];
+    struct mctp_rx_stream rx_streams[MCTP_RX_STREAM_COUNT];
+
+    /* Message types whose integrity check trailer the core handles, the
+     * others are passed as is. See mctp_set_msg_ic() */
+    uint32_t ic_types[128 / 32];
+
+    /* Application provided reassembly buffers */
+    mctp_rx_buf_get_fn rx_buf_get;
+    mctp_rx_buf_put_fn rx_buf_put;
+    void              *rx_buf_data;
+
+    /* Packet capture callback and ring */
+    mctp_capture_fn           capture;
+    void                     *capture_data;
+    struct mctp_capture_ring *capture_ring;
+
+    /* Message reassembly. Contexts are found by (src, dest, tag) through
+     * an open addressing hash holding context index + 1, zero marking an
+     * empty slot. Contexts in use are flagged in 'msg_ctx_used'. */
+    struct mctp_msg_ctx msg_ctxs[MCTP_MSG_CTX_COUNT];
+    uint8_t             msg_ctx_hash[MCTP_MSG_CTX_HASH_SIZE];
+    uint64_t            msg_ctx_used;
+
+    /* Reassembly timeouts: a hashed timer wheel of MCTP_MSG_CTX_WHEEL_TICK
+     * ms slots, each flagging the contexts whose deadline falls in it.
+     * 'wheel_now' is the tick reached by the last mctp_poll(). */
+    uint64_t    msg_ctx_wheel[MCTP_MSG_CTX_WHEEL_SLOTS];
+    uint32_t    wheel_now;
+    mctp_now_fn now;
+    void       *now_data;
+
+    /* Outstanding requests: the tags taken at each EID, so only responses
+     * to one of them are looked up, and the requests flagged in 'req_used' */
+    uint8_t         req_tags[256];
+    struct mctp_req reqs[MCTP_REQ_COUNT];
+    uint32_t        req_used;
+
+    struct mctp_stats stats;
+
+    /* Built-in control responses, by enum mctp_ctrl_tmpl_id */
+    struct mctp_ctrl_tmpl ctrl_tmpls[MCTP_CTRL_TMPL_COUNT];
+
+    /* Allocator, 'ctx_pool' holding the reassembly buffers */
+    const struct mctp_alloc_ops *alloc_ops;
+    void                        *alloc_data;
+    uintptr_t                    ctx_pool;
 
     enum
     {
         ROUTE_ENDPOINT,
         ROUTE_BRIDGE,
     } route_policy;
+    bool   bridge_store; /* Bridge by reassembling every message */
     size_t max_message_size;
 };
 
@@ -97,24 +193,25 @@ struct mctp
 /* 64kb should be sufficient for a single message. Applications
  * requiring higher sizes can override by setting max_message_size.*/
 #ifndef MCTP_MAX_MESSAGE_SIZE
-#define MCTP_MAX_MESSAGE_SIZE MCTP_USB_MSGQ_MAX_FRAME_SIZE
+#define MCTP_MAX_MESSAGE_SIZE MCTP_MSG_CTX_BUF_SIZE
 #endif
 
-static int mctp_message_tx_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid_t dest, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len);
+static int  mctp_message_tx_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid_t dest, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len);
+static void mctp_bus_enqueue(struct mctp_bus *bus, struct mctp_pktbuf *head, struct mctp_pktbuf *tail, size_t n);
 
 struct mctp_pktbuf *mctp_pktbuf_alloc(struct mctp_binding *binding, size_t len)
 {
     struct mctp_pktbuf *buf;
     size_t              size;
 
-    size = binding->pkt_size + binding->pkt_header + binding->pkt_trailer;
-    if ( len > size )
+    /* Bounded by the pool items, the MTU may have grown since */
+    size = binding->pkt_pool_size;
+    if ( binding->pkt_header + len > size )
     {
         return NULL;
     }
 
-    /* todo: pools */
-    buf = __mctp_alloc(sizeof(*buf) + size);
+    buf = binding->mctp->alloc_ops->pkt_alloc(binding->mctp->alloc_data, binding->pkt_pool);
 
     if ( ! buf )
         return NULL;
@@ -124,13 +221,31 @@ struct mctp_pktbuf *mctp_pktbuf_alloc(struct mctp_binding *binding, size_t len)
     buf->end          = buf->start + len;
     buf->mctp_hdr_off = buf->start;
     buf->next         = NULL;
+    buf->ext_data     = NULL;
+    buf->ext_len      = 0;
+    buf->done         = NULL;
+    buf->mctp         = binding->mctp;
+    buf->pool         = binding->pkt_pool;
 
     return buf;
 }
 
+/* Return a packet to its pool, packets built by hand came from the core */
+static inline void mctp_pktbuf_release(struct mctp_pktbuf *pkt)
+{
+    if ( pkt->mctp )
+        pkt->mctp->alloc_ops->free(pkt->mctp->alloc_data, pkt->pool, pkt);
+    else
+        __mctp_free(pkt);
+}
+
 void mctp_pktbuf_free(struct mctp_pktbuf *pkt)
 {
-    __mctp_free(pkt);
+    /* Past the last packet of a message, its memory is no longer referenced */
+    if ( pkt->done )
+        pkt->done(pkt->done_arg);
+
+    mctp_pktbuf_release(pkt);
 }
 
 void *mctp_pktbuf_alloc_start(struct mctp_pktbuf *pkt, size_t size)
@@ -175,97 +290,413 @@ void *mctp_pktbuf_pop(struct mctp_pktbuf *pkt, size_t len)
 }
 
 /* Message reassembly */
+static inline unsigned int mctp_msg_ctx_hash(uint8_t src, uint8_t dest, uint8_t tag)
+{
+    uint32_t key = src | (dest << 8) | (tag << 16);
+
+    /* Multiplicative hashing, the middle bits are the best mixed */
+    return ((key * 2654435761u) >> 16) & (MCTP_MSG_CTX_HASH_SIZE - 1);
+}
+
+/* Whether 'ctx' is still in use, a callback may have dropped it */
+static inline bool mctp_msg_ctx_in_use(const struct mctp *mctp, const struct mctp_msg_ctx *ctx)
+{
+    return mctp->msg_ctx_used & ((uint64_t) 1 << (ctx - mctp->msg_ctxs));
+}
+
 static struct mctp_msg_ctx *mctp_msg_ctx_lookup(struct mctp *mctp, uint8_t src, uint8_t dest, uint8_t tag)
 {
-    unsigned int i;
+    unsigned int slot = mctp_msg_ctx_hash(src, dest, tag);
+    uint8_t      idx;
 
-    /* @todo: better lookup, if we add support for more outstanding
-	 * message contexts */
-    for ( i = 0; i < ARRAY_SIZE(mctp->msg_ctxs); i++ )
+    /* The table is at most half full, so an empty slot ends the probe */
+    while ( (idx = mctp->msg_ctx_hash[slot]) != 0 )
     {
-        struct mctp_msg_ctx *ctx = &mctp->msg_ctxs[i];
+        struct mctp_msg_ctx *ctx = &mctp->msg_ctxs[idx - 1];
         if ( ctx->src == src && ctx->dest == dest && ctx->tag == tag )
             return ctx;
+
+        slot = (slot + 1) & (MCTP_MSG_CTX_HASH_SIZE - 1);
     }
 
     return NULL;
 }
 
-static struct mctp_msg_ctx *mctp_msg_ctx_create(struct mctp *mctp, uint8_t src, uint8_t dest, uint8_t tag)
+static void mctp_pktbuf_free_list(struct mctp_pktbuf *pkt)
 {
-    struct mctp_msg_ctx *ctx = NULL;
-    unsigned int         i;
+    struct mctp_pktbuf *next;
 
-    for ( i = 0; i < ARRAY_SIZE(mctp->msg_ctxs); i++ )
+    for ( ; pkt; pkt = next )
     {
-        struct mctp_msg_ctx *tmp = &mctp->msg_ctxs[i];
-        if ( ! tmp->src )
-        {
-            ctx = tmp;
-            break;
-        }
+        next = pkt->next;
+        mctp_pktbuf_release(pkt);
     }
+}
 
-    if ( ! ctx )
-        return NULL;
+static void mctp_msg_ctx_reset(struct mctp_msg_ctx *ctx)
+{
+    mctp_pktbuf_free_list(ctx->pkts);
+    ctx->pkts          = NULL;
+    ctx->pkts_tail     = NULL;
+    ctx->p_cur         = ctx->buf;
+    ctx->free_bytes    = ctx->buf_alloc_size;
+    ctx->buf_size      = 0;
+    ctx->fragment_size = 0;
+    ctx->ic_crc        = 0;
+    ctx->ic_done       = 0;
+    ctx->ic_carry_len  = 0;
+}
 
-    ctx->src  = src;
-    ctx->dest = dest;
-    ctx->tag  = tag;
+/* Reassemble straight into a buffer of the application, when it has one */
+static bool mctp_msg_ctx_get_rx_buf(struct mctp *mctp, struct mctp_msg_ctx *ctx, uint8_t src, uint8_t tag)
+{
+    struct mctp_rx_buf rx_buf;
 
-    if ( ctx->buf == NULL )
+    /* A bridge forwards the messages, the application never sees them */
+    if ( ! mctp->rx_buf_get || mctp->route_policy != ROUTE_ENDPOINT || mctp->rx_buf_get(src, tag, mctp->rx_buf_data, &rx_buf) )
+        return false;
+
+    ctx->rx_buf         = rx_buf.buf;
+    ctx->buf            = (uint8_t *) rx_buf.buf + rx_buf.offset;
+    ctx->buf_alloc_size = rx_buf.size;
+
+    return true;
+}
+
+/* Hand the reassembly buffer back to its owner */
+static void mctp_msg_ctx_put_buf(struct mctp *mctp, struct mctp_msg_ctx *ctx)
+{
+    if ( ctx->rx_buf )
+        mctp->rx_buf_put(mctp->rx_buf_data, ctx->rx_buf);
+    else if ( ctx->buf )
+        mctp->alloc_ops->free(mctp->alloc_data, mctp->ctx_pool, ctx->buf);
+
+    ctx->buf    = NULL;
+    ctx->rx_buf = NULL;
+}
+
+/* Set the deadline of a context from the last polled tick, one tick later
+ * than the timeout since that tick may have started long ago */
+static inline void mctp_msg_ctx_arm(struct mctp *mctp, struct mctp_msg_ctx *ctx)
+{
+    const unsigned int mask = MCTP_MSG_CTX_WHEEL_SLOTS - 1;
+    uint64_t           bit  = (uint64_t) 1 << (ctx - mctp->msg_ctxs);
+
+    mctp->msg_ctx_wheel[ctx->deadline & mask] &= ~bit;
+    ctx->deadline = mctp->wheel_now + MCTP_MSG_CTX_WHEEL_SLOTS + 1;
+    mctp->msg_ctx_wheel[ctx->deadline & mask] |= bit;
+}
+
+/* Requests expire from the last polled tick as well */
+static inline uint32_t mctp_req_deadline(struct mctp *mctp)
+{
+    return mctp->wheel_now + (MCTP_REQ_TIMEOUT + MCTP_MSG_CTX_WHEEL_TICK - 1) / MCTP_MSG_CTX_WHEEL_TICK + 1;
+}
+
+/* Whether a message answers one of our requests, a single load for others */
+static inline bool mctp_req_is_response(struct mctp *mctp, mctp_eid_t src, bool tag_owner, uint8_t tag)
+{
+    return ! tag_owner && (mctp->req_tags[src] & (1 << tag));
+}
+
+static struct mctp_req *mctp_req_lookup(struct mctp *mctp, mctp_eid_t eid, uint8_t tag)
+{
+    uint32_t used = mctp->req_used;
+
+    while ( used )
     {
-        ctx->buf        = __mctp_alloc_context(MCTP_USB_MAX_CONTEXT_SIZE);
-        ctx->p_cur      = ctx->buf;
-        ctx->buf_size   = 0;
-        ctx->free_bytes = MCTP_USB_MAX_CONTEXT_SIZE;
+        struct mctp_req *req = &mctp->reqs[__builtin_ctz(used)];
+
+        used &= used - 1;
+        if ( req->eid == eid && req->tag == tag )
+            return req;
     }
 
-    return ctx;
+    return NULL;
+}
+
+/* Release the request before calling back, which may issue the next one */
+static void mctp_req_complete(struct mctp *mctp, struct mctp_req *req, void *msg, size_t len)
+{
+    mctp_resp_fn fn   = req->fn;
+    void        *data = req->data;
+
+    mctp->req_tags[req->eid] &= ~(1 << req->tag);
+    mctp->req_used &= ~((uint32_t) 1 << (req - mctp->reqs));
+
+    fn(req->eid, req->tag, data, msg, len);
 }
 
-static void mctp_msg_ctx_drop(struct mctp_msg_ctx *ctx)
+static struct mctp_msg_ctx *mctp_msg_ctx_create(struct mctp *mctp, uint8_t src, uint8_t dest, uint8_t tag, bool scatter,
+                                                const struct mctp_rx_stream *stream)
 {
-    if ( ctx->buf )
+    struct mctp_msg_ctx *ctx;
+    unsigned int         i, slot;
+
+    if ( mctp->msg_ctx_used == (uint64_t) -1 >> (64 - MCTP_MSG_CTX_COUNT) )
+        return NULL;
+
+    i   = __builtin_ctzll(~mctp->msg_ctx_used);
+    ctx = &mctp->msg_ctxs[i];
+
+    /* Scattered messages are bound by the same size, only the copy is saved.
+     * Streamed ones keep nothing and are not bound */
+    ctx->buf            = NULL;
+    ctx->rx_buf         = NULL;
+    ctx->buf_alloc_size = stream ? SIZE_MAX : MCTP_MSG_CTX_BUF_SIZE;
+    if ( ! scatter && ! stream && ! mctp_msg_ctx_get_rx_buf(mctp, ctx, src, tag) )
     {
-        __mctp_free_context(ctx->buf);
-        ctx->buf = NULL;
+        ctx->buf = mctp->alloc_ops->ctx_alloc(mctp->alloc_data, mctp->ctx_pool);
+        if ( ! ctx->buf )
+            return NULL;
     }
 
-    ctx->src = 0;
+    ctx->scatter        = scatter;
+    ctx->stream         = stream;
+    ctx->pkts           = NULL;
+    ctx->src            = src;
+    ctx->dest           = dest;
+    ctx->tag            = tag;
+    mctp_msg_ctx_reset(ctx);
+
+    slot = mctp_msg_ctx_hash(src, dest, tag);
+    while ( mctp->msg_ctx_hash[slot] ) slot = (slot + 1) & (MCTP_MSG_CTX_HASH_SIZE - 1);
+
+    mctp->msg_ctx_hash[slot] = i + 1;
+    mctp->msg_ctx_used |= (uint64_t) 1 << i;
+    mctp_msg_ctx_arm(mctp, ctx);
+
+    return ctx;
 }
 
-static void mctp_msg_ctx_reset(struct mctp_msg_ctx *ctx)
+/* Release a context. A message still being streamed is abandoned, which
+ * its handler is told once the context is free */
+static void mctp_msg_ctx_drop(struct mctp *mctp, struct mctp_msg_ctx *ctx)
 {
-    ctx->buf_size      = 0;
-    ctx->fragment_size = 0;
-    if ( ctx->buf )
+    const struct mctp_rx_stream *stream = ctx->stream;
+    const unsigned int           mask   = MCTP_MSG_CTX_HASH_SIZE - 1;
+    unsigned int                 idx    = (ctx - mctp->msg_ctxs) + 1;
+    unsigned int                 hole, slot, home;
+
+    hole = mctp_msg_ctx_hash(ctx->src, ctx->dest, ctx->tag);
+    while ( mctp->msg_ctx_hash[hole] != idx ) hole = (hole + 1) & mask;
+
+    /* Backward shift deletion: move up any later entry of the probe run
+     * whose home slot does not lie between the hole and itself */
+    for ( slot = (hole + 1) & mask; mctp->msg_ctx_hash[slot]; slot = (slot + 1) & mask )
     {
-        __mctp_free_context(ctx->buf);
-        ctx->buf = NULL;
+        struct mctp_msg_ctx *tmp = &mctp->msg_ctxs[mctp->msg_ctx_hash[slot] - 1];
+
+        home = mctp_msg_ctx_hash(tmp->src, tmp->dest, tmp->tag);
+        if ( ((slot - home) & mask) >= ((slot - hole) & mask) )
+        {
+            mctp->msg_ctx_hash[hole] = mctp->msg_ctx_hash[slot];
+            hole                     = slot;
+        }
     }
+
+    mctp->msg_ctx_hash[hole] = 0;
+    mctp->msg_ctx_used &= ~((uint64_t) 1 << (idx - 1));
+    mctp->msg_ctx_wheel[ctx->deadline & (MCTP_MSG_CTX_WHEEL_SLOTS - 1)] &= ~((uint64_t) 1 << (idx - 1));
+
+    mctp_pktbuf_free_list(ctx->pkts);
+    ctx->pkts   = NULL;
+    ctx->stream = NULL;
+
+    mctp_msg_ctx_put_buf(mctp, ctx);
+
+    if ( stream )
+        stream->fn(ctx->src, ctx->tag_owner, ctx->tag, stream->data, MCTP_RX_STREAM_ABORT, NULL, 0);
 }
 
 static int mctp_msg_ctx_add_pkt(struct mctp_msg_ctx *ctx, struct mctp_pktbuf *pkt, size_t max_size)
 {
     size_t len;
 
-#ifdef DEBUG
-    if ( ctx->buf == NULL )
-        return -1;
-#endif
     len = MCTP_PKTBUF_SIZE(pkt) - sizeof(struct mctp_hdr);
 
     /* No buffer - drop the message */
     if ( ctx->free_bytes < len )
         return -1;
 
+    if ( ctx->scatter )
+    {
+        /* The context takes ownership of the packet */
+        pkt->next = NULL;
+        if ( ctx->pkts_tail )
+            ctx->pkts_tail->next = pkt;
+        else
+            ctx->pkts = pkt;
+
+        ctx->pkts_tail = pkt;
+        ctx->buf_size += len;
+        ctx->free_bytes -= len;
+
+        return 0;
+    }
+
+#ifdef DEBUG
+    if ( ctx->buf == NULL )
+        return -1;
+#endif
+
     memcpy((uint8_t *) ctx->p_cur, MCTP_PKTBUF_DATA(pkt), len);
 
     ctx->buf_size += len;
     ctx->free_bytes -= len;
     ctx->p_cur += len;
 
+#if ( MCTP_MESSAGE_IC > 0 )
+    /* Run the integrity check over the fragment while it is still in the
+     * cache, holding back the last bytes which may turn out to be the
+     * trailer once the end of message arrives */
+    if ( ctx->ic && ctx->buf_size > ctx->ic_done + MCTP_MSG_IC_SIZE )
+    {
+        len = ctx->buf_size - MCTP_MSG_IC_SIZE - ctx->ic_done;
+
+        ctx->ic_crc = crc32c_update(ctx->ic_crc, (uint8_t *) ctx->buf + ctx->ic_done, len);
+        ctx->ic_done += len;
+    }
+#endif
+
+    return 0;
+}
+
+/* Whether the core appends and verifies the trailer of a message starting
+ * with 'type'. It is end to end, bridges forward it as is */
+static inline bool mctp_msg_ic(const struct mctp *mctp, uint8_t type)
+{
+    uint8_t t = type & ~MCTP_MSG_IC_BIT;
+
+    return MCTP_MESSAGE_IC > 0 && (type & MCTP_MSG_IC_BIT) && mctp->route_policy == ROUTE_ENDPOINT &&
+           (mctp->ic_types[t / 32] & ((uint32_t) 1 << (t % 32)));
+}
+
+#if ( MCTP_MESSAGE_IC > 0 )
+/* Load the integrity check trailer, least significant byte first */
+static inline uint32_t mctp_msg_ic_load(const uint8_t *ic)
+{
+    return (uint32_t) ic[0] | ((uint32_t) ic[1] << 8) | ((uint32_t) ic[2] << 16) | ((uint32_t) ic[3] << 24);
+}
+
+/*
+ * Complete the integrity check of a received message, 'crc' already covers
+ * the first 'done' bytes. On success 'len' is updated to exclude the
+ * trailer.
+ */
+static int mctp_msg_ic_verify(const uint8_t *msg, size_t *len, uint32_t crc, size_t done)
+{
+    size_t   body;
+    uint32_t ic;
+
+    if ( *len <= MCTP_MSG_IC_SIZE )
+        return -EPROTO;
+
+    body = *len - MCTP_MSG_IC_SIZE;
+    crc  = crc32c_update(crc, msg + done, body - done);
+    ic   = mctp_msg_ic_load(msg + body);
+
+    if ( crc != ic )
+    {
+        mctp_prdebug("Message integrity check failed: 0x%08x, expected 0x%08x", ic, crc);
+        return -EBADMSG;
+    }
+
+    *len = body;
+
+    return 0;
+}
+
+/*
+ * Integrity check of a message scattered over a packet list. On success
+ * 'len' is updated and the packets are trimmed to exclude the trailer,
+ * which may straddle packets.
+ */
+static int mctp_msg_ic_verify_pkts(struct mctp_pktbuf *pkts, size_t *len)
+{
+    struct mctp_pktbuf *pkt;
+    uint8_t             ic[MCTP_MSG_IC_SIZE];
+    size_t              body, off, n, keep;
+    uint32_t            crc = 0;
+
+    if ( *len <= MCTP_MSG_IC_SIZE )
+        return -EPROTO;
+
+    body = *len - MCTP_MSG_IC_SIZE;
+    for ( pkt = pkts, off = 0; pkt; pkt = pkt->next, off += n )
+    {
+        n    = MCTP_PKTBUF_PAYLOAD_SIZE(pkt);
+        keep = (off >= body) ? 0 : (body - off < n) ? body - off : n;
+
+        crc = crc32c_update(crc, MCTP_PKTBUF_DATA(pkt), keep);
+        if ( keep < n )
+        {
+            memcpy(ic + off + keep - body, (uint8_t *) MCTP_PKTBUF_DATA(pkt) + keep, n - keep);
+            pkt->end -= n - keep;
+        }
+    }
+
+    if ( crc != mctp_msg_ic_load(ic) )
+    {
+        mctp_prdebug("Message integrity check failed: 0x%08x, expected 0x%08x", mctp_msg_ic_load(ic), crc);
+        return -EBADMSG;
+    }
+
+    *len = body;
+
+    return 0;
+}
+
+/* Store the integrity check trailer, least significant byte first */
+static void mctp_msg_ic_store(uint8_t *ic, uint32_t crc)
+{
+    ic[0] = crc & 0xff;
+    ic[1] = (crc >> 8) & 0xff;
+    ic[2] = (crc >> 16) & 0xff;
+    ic[3] = crc >> 24;
+}
+#endif
+
+/*
+ * Hand a fragment of a streamed message over to its handler. With an
+ * integrity check, the last MCTP_MSG_IC_SIZE bytes seen are held back since
+ * they may turn out to be the trailer; they are put in front of the next
+ * fragment, over its MCTP header which is done with, so that each chunk is
+ * still contiguous. Returns -EBADMSG, with nothing delivered, when the end
+ * of the message fails its integrity check.
+ */
+static int mctp_rx_stream_pkt(struct mctp_msg_ctx *ctx, struct mctp_pktbuf *pkt, unsigned int flags)
+{
+    uint8_t *chunk = MCTP_PKTBUF_DATA(pkt);
+    size_t   len   = MCTP_PKTBUF_PAYLOAD_SIZE(pkt);
+
+    ctx->buf_size += len;
+
+#if ( MCTP_MESSAGE_IC > 0 )
+    if ( ctx->ic )
+    {
+        size_t keep;
+
+        chunk -= ctx->ic_carry_len;
+        memcpy(chunk, ctx->ic_carry, ctx->ic_carry_len);
+        len += ctx->ic_carry_len;
+
+        keep = len < MCTP_MSG_IC_SIZE ? len : MCTP_MSG_IC_SIZE;
+        len -= keep;
+        memcpy(ctx->ic_carry, chunk + len, keep);
+        ctx->ic_carry_len = keep;
+        ctx->ic_crc       = crc32c_update(ctx->ic_crc, chunk, len);
+
+        if ( (flags & MCTP_RX_STREAM_EOM) && (ctx->buf_size <= MCTP_MSG_IC_SIZE || ctx->ic_crc != mctp_msg_ic_load(ctx->ic_carry)) )
+        {
+            mctp_prdebug("Message integrity check failed on a streamed message");
+            return -EBADMSG;
+        }
+    }
+#endif
+
+    ctx->stream->fn(ctx->src, ctx->tag_owner, ctx->tag, ctx->stream->data, flags, chunk, len);
+
     return 0;
 }
 
@@ -279,15 +710,33 @@ struct mctp *mctp_init(void)
     if ( ! mctp )
         return NULL;
 
-    if ( __mctp_mem_init() != 0 )
-        return NULL;
+    /* Context indexes are tracked in a 64 bits mask and the hash mask
+     * requires a power of two */
+    BUILD_ASSERT(MCTP_MSG_CTX_COUNT >= 1 && MCTP_MSG_CTX_COUNT <= 64);
+    BUILD_ASSERT((MCTP_MSG_CTX_COUNT & (MCTP_MSG_CTX_COUNT - 1)) == 0);
+    BUILD_ASSERT((MCTP_MSG_CTX_WHEEL_SLOTS & (MCTP_MSG_CTX_WHEEL_SLOTS - 1)) == 0);
+    BUILD_ASSERT(MCTP_MSG_CTX_WHEEL_TICK >= 1);
+    BUILD_ASSERT(MCTP_REQ_COUNT >= 1 && MCTP_REQ_COUNT <= 32);
 
     memset(mctp, 0, sizeof(*mctp));
     mctp->max_message_size = MCTP_MAX_MESSAGE_SIZE;
+    mctp->alloc_ops        = &mctp_default_alloc_ops;
 
     return mctp;
 }
 
+int mctp_set_alloc_ops(struct mctp *mctp, const struct mctp_alloc_ops *ops, void *data)
+{
+    /* Pools already taken from the current allocator */
+    if ( mctp->ctx_pool )
+        return -EBUSY;
+
+    mctp->alloc_ops  = ops;
+    mctp->alloc_data = data;
+
+    return 0;
+}
+
 void mctp_set_max_message_size(struct mctp *mctp, size_t message_size)
 {
     mctp->max_message_size = message_size;
@@ -299,6 +748,88 @@ void mctp_set_capture_handler(struct mctp *mctp, mctp_capture_fn fn, void *user)
     mctp->capture_data = user;
 }
 
+int mctp_capture_ring_init(struct mctp_capture_ring *ring, struct mctp_capture_rec *recs, uint32_t count, mctp_capture_clock_fn clock)
+{
+    /* Positions are free running, records found by masking */
+    if ( ! count || (count & (count - 1)) )
+        return -EINVAL;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->recs  = recs;
+    ring->count = count;
+    ring->clock = clock;
+
+    return 0;
+}
+
+void mctp_set_capture_ring(struct mctp *mctp, struct mctp_capture_ring *ring)
+{
+    mctp->capture_ring = ring;
+}
+
+/*
+ * Record a packet. 'head' is only written here, and published once the
+ * record is complete; 'tail' only by the drainer, once it is done reading.
+ */
+static void mctp_capture_ring_put(struct mctp_capture_ring *ring, const struct mctp_pktbuf *pkt, bool outgoing)
+{
+    struct mctp_capture_rec *rec;
+    uint32_t                 head = ring->head;
+    size_t                   size, ext, n;
+
+    /* 'caplen' is a byte */
+    BUILD_ASSERT(MCTP_CAPTURE_SNAPLEN <= 255);
+
+    if ( head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == ring->count )
+    {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    rec  = &ring->recs[head & (ring->count - 1)];
+    size = MCTP_PKTBUF_SIZE(pkt);
+    ext  = outgoing ? pkt->ext_len : 0;
+    n    = MIN(size, MCTP_CAPTURE_SNAPLEN);
+
+    rec->ts       = ring->clock ? ring->clock() : 0;
+    rec->len      = size + ext;
+    rec->outgoing = outgoing;
+
+    /* A copy of constant size is a few moves, past the end is still the buffer */
+    if ( pkt->size - pkt->mctp_hdr_off >= MCTP_CAPTURE_SNAPLEN )
+        memcpy(rec->data, MCTP_PKTBUF_HDR(pkt), MCTP_CAPTURE_SNAPLEN);
+    else
+        memcpy(rec->data, MCTP_PKTBUF_HDR(pkt), n);
+
+    /* Gathered packets go on in the message */
+    if ( n < MCTP_CAPTURE_SNAPLEN && ext )
+    {
+        ext = MIN(ext, MCTP_CAPTURE_SNAPLEN - n);
+        memcpy(rec->data + n, pkt->ext_data, ext);
+        n += ext;
+    }
+
+    rec->caplen = n;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+size_t mctp_capture_ring_peek(struct mctp_capture_ring *ring, const struct mctp_capture_rec **first)
+{
+    uint32_t tail = ring->tail;
+    uint32_t n    = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+    uint32_t idx  = tail & (ring->count - 1);
+
+    /* Up to the end of the records, the rest comes with the next peek */
+    *first = &ring->recs[idx];
+
+    return MIN(n, ring->count - idx);
+}
+
+void mctp_capture_ring_consume(struct mctp_capture_ring *ring, size_t n)
+{
+    __atomic_store_n(&ring->tail, ring->tail + n, __ATOMIC_RELEASE);
+}
+
 static void mctp_bus_destroy(struct mctp_bus *bus)
 {
     while ( bus->tx_queue_head )
@@ -306,7 +837,7 @@ static void mctp_bus_destroy(struct mctp_bus *bus)
         struct mctp_pktbuf *curr = bus->tx_queue_head;
 
         bus->tx_queue_head = curr->next;
-        __mctp_free(curr);
+        mctp_pktbuf_free(curr);
     }
 }
 
@@ -315,18 +846,146 @@ void mctp_destroy(struct mctp *mctp)
     size_t i;
 
     /* Cleanup message assembly contexts */
-    BUILD_ASSERT(ARRAY_SIZE(mctp->msg_ctxs) < SIZE_MAX);
     for ( i = 0; i < ARRAY_SIZE(mctp->msg_ctxs); i++ )
     {
         struct mctp_msg_ctx *tmp = &mctp->msg_ctxs[i];
-        if ( tmp->buf )
-            __mctp_free(tmp->buf);
+
+        if ( ! (mctp->msg_ctx_used & ((uint64_t) 1 << i)) )
+            continue;
+
+        mctp_pktbuf_free_list(tmp->pkts);
+        mctp_msg_ctx_put_buf(mctp, tmp);
     }
 
     while ( mctp->n_busses-- ) mctp_bus_destroy(&mctp->busses[mctp->n_busses]);
 
-    __mctp_free(mctp->busses);
-    __mctp_free(mctp);
+    /* The instance itself came from hal_alloc(), which keeps its memory */
+}
+
+void mctp_set_now_op(struct mctp *mctp, mctp_now_fn now, void *data)
+{
+    size_t i;
+
+    mctp->now      = now;
+    mctp->now_data = data;
+    if ( ! now )
+        return;
+
+    /* Deadlines are relative to the new clock from now on */
+    mctp->wheel_now = now(data) / MCTP_MSG_CTX_WHEEL_TICK;
+    for ( i = 0; i < ARRAY_SIZE(mctp->msg_ctxs); i++ )
+    {
+        if ( mctp->msg_ctx_used & ((uint64_t) 1 << i) )
+            mctp_msg_ctx_arm(mctp, &mctp->msg_ctxs[i]);
+    }
+
+    for ( i = 0; i < ARRAY_SIZE(mctp->reqs); i++ )
+    {
+        if ( mctp->req_used & ((uint32_t) 1 << i) )
+            mctp->reqs[i].deadline = mctp_req_deadline(mctp);
+    }
+}
+
+int mctp_poll(struct mctp *mctp)
+{
+    uint32_t now, tick, used;
+    int      expired = 0;
+
+    if ( ! mctp->now )
+        return 0;
+
+    now = mctp->now(mctp->now_data) / MCTP_MSG_CTX_WHEEL_TICK;
+
+    /* Visit the slots of the ticks elapsed since the last poll, each slot
+     * at most once. A slot also holds contexts due a full turn later */
+    tick = mctp->wheel_now;
+    if ( now - tick > MCTP_MSG_CTX_WHEEL_SLOTS )
+        tick = now - MCTP_MSG_CTX_WHEEL_SLOTS;
+
+    while ( tick != now )
+    {
+        uint64_t due = mctp->msg_ctx_wheel[++tick & (MCTP_MSG_CTX_WHEEL_SLOTS - 1)];
+
+        while ( due )
+        {
+            struct mctp_msg_ctx *ctx = &mctp->msg_ctxs[__builtin_ctzll(due)];
+
+            due &= due - 1;
+            if ( (int32_t) (ctx->deadline - now) > 0 )
+                continue;
+
+            mctp_prdebug("Reassembly timeout, src %d tag %d", ctx->src, ctx->tag);
+            mctp_msg_ctx_drop(mctp, ctx);
+            mctp->stats.rx_ctx_timeouts++;
+            expired++;
+        }
+    }
+
+    mctp->wheel_now = now;
+
+    /* Requests left without a response, completed empty */
+    used = mctp->req_used;
+    while ( used )
+    {
+        struct mctp_req *req = &mctp->reqs[__builtin_ctz(used)];
+
+        used &= used - 1;
+        if ( (int32_t) (req->deadline - now) > 0 )
+            continue;
+
+        mctp_prdebug("Request timeout, eid %d tag %d", req->eid, req->tag);
+        mctp->stats.req_timeouts++;
+        expired++;
+        mctp_req_complete(mctp, req, NULL, 0);
+    }
+
+    return expired;
+}
+
+void mctp_get_stats(struct mctp *mctp, struct mctp_stats *stats)
+{
+    *stats = mctp->stats;
+}
+
+static void mctp_ctrl_tmpl_set(struct mctp_ctrl_tmpl *tmpl, uint8_t command, const uint8_t *data, size_t len)
+{
+    struct mctp_ctrl_msg_hdr *hdr = (struct mctp_ctrl_msg_hdr *) tmpl->msg;
+
+    hdr->ic_msg_type     = MCTP_CTRL_HDR_MSG_TYPE;
+    hdr->command_code    = command;
+    hdr->completion_code = MCTP_CTRL_CC_SUCCESS;
+    memcpy(hdr + 1, data, len);
+    tmpl->len = sizeof(*hdr) + len;
+}
+
+int mctp_set_ctrl_responder(struct mctp *mctp, const struct mctp_ctrl_info *info)
+{
+    /* EID, patched per bus, simple endpoint with a dynamic EID, no medium specific information */
+    static const uint8_t eid[3] = {0, 0x00, 0x00};
+    /* One entry: 1.3.1, the DSP0236 version of both the base specification and the control protocol */
+    static const uint8_t version[5] = {1, 0xF1, 0xF3, 0xF1, 0x00};
+    uint8_t              types[2 + MCTP_CTRL_MSG_TYPES_MAX];
+
+    memset(mctp->ctrl_tmpls, 0, sizeof(mctp->ctrl_tmpls));
+    if ( ! info )
+        return 0;
+
+    if ( info->n_msg_types > MCTP_CTRL_MSG_TYPES_MAX )
+        return -EINVAL;
+
+    types[0] = 1 + info->n_msg_types;
+    types[1] = MCTP_CTRL_HDR_MSG_TYPE;
+    if ( info->n_msg_types )
+        memcpy(&types[2], info->msg_types, info->n_msg_types);
+
+    mctp_ctrl_tmpl_set(&mctp->ctrl_tmpls[MCTP_CTRL_TMPL_EID], MCTP_CTRL_CMD_GET_ENDPOINT_ID, eid, sizeof(eid));
+    mctp_ctrl_tmpl_set(&mctp->ctrl_tmpls[MCTP_CTRL_TMPL_VERSION], MCTP_CTRL_CMD_GET_VERSION_SUPPORT, version, sizeof(version));
+    mctp_ctrl_tmpl_set(&mctp->ctrl_tmpls[MCTP_CTRL_TMPL_TYPES], MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT, types, 2 + info->n_msg_types);
+
+    if ( info->uuid )
+        mctp_ctrl_tmpl_set(&mctp->ctrl_tmpls[MCTP_CTRL_TMPL_UUID], MCTP_CTRL_CMD_GET_ENDPOINT_UUID, info->uuid, 16);
+
+    return 0;
 }
 
 int mctp_set_rx_all(struct mctp *mctp, mctp_rx_fn fn, void *data)
@@ -336,71 +995,259 @@ int mctp_set_rx_all(struct mctp *mctp, mctp_rx_fn fn, void *data)
     return 0;
 }
 
-static struct mctp_bus *find_bus_for_eid(struct mctp *mctp, mctp_eid_t dest __attribute__((unused)))
+int mctp_set_rx_pkts(struct mctp *mctp, mctp_rx_pkts_fn fn, void *data)
 {
-    if ( mctp->n_busses == 0 )
-        return NULL;
+    mctp->message_rx_pkts      = fn;
+    mctp->message_rx_pkts_data = data;
+    return 0;
+}
+
+int mctp_set_rx_buf_ops(struct mctp *mctp, mctp_rx_buf_get_fn get, mctp_rx_buf_put_fn put, void *data)
+{
+    if ( get && ! put )
+        return -EINVAL;
 
-    /* for now, just use the first bus. For full routing support,
-	 * we will need a table of neighbours */
-    return &mctp->busses[0];
+    mctp->rx_buf_get  = get;
+    mctp->rx_buf_put  = put;
+    mctp->rx_buf_data = data;
+    return 0;
+}
+
+int mctp_set_rx_stream(struct mctp *mctp, uint8_t msg_type, mctp_rx_stream_fn fn, void *data)
+{
+    struct mctp_rx_stream *stream = NULL;
+    uint32_t               bit    = (uint32_t) 1 << (msg_type % 32);
+    size_t                 i;
+
+    /* The integrity check trailer held back is put back over the MCTP header */
+    BUILD_ASSERT(sizeof(struct mctp_hdr) >= MCTP_MSG_IC_SIZE);
+
+    /* Control messages are parsed in place by the core */
+    if ( msg_type == MCTP_CTRL_HDR_MSG_TYPE || (msg_type & MCTP_MSG_IC_BIT) )
+        return -EINVAL;
+
+    for ( i = 0; i < ARRAY_SIZE(mctp->rx_streams); i++ )
+    {
+        if ( mctp->rx_streams[i].fn && mctp->rx_streams[i].type == msg_type )
+        {
+            stream = &mctp->rx_streams[i];
+            break;
+        }
+
+        if ( ! mctp->rx_streams[i].fn && ! stream )
+            stream = &mctp->rx_streams[i];
+    }
+
+    if ( ! fn )
+    {
+        if ( ! stream || ! stream->fn || stream->type != msg_type )
+            return 0;
+
+        /* Abandon the messages in progress, which have no handler left */
+        for ( i = 0; i < ARRAY_SIZE(mctp->msg_ctxs); i++ )
+        {
+            if ( (mctp->msg_ctx_used & ((uint64_t) 1 << i)) && mctp->msg_ctxs[i].stream == stream )
+                mctp_msg_ctx_drop(mctp, &mctp->msg_ctxs[i]);
+        }
+
+        stream->fn = NULL;
+        mctp->rx_stream_types[msg_type / 32] &= ~bit;
+        return 0;
+    }
+
+    if ( ! stream )
+        return -ENOSPC;
+
+    stream->type = msg_type;
+    stream->fn   = fn;
+    stream->data = data;
+    mctp->rx_stream_types[msg_type / 32] |= bit;
+    return 0;
+}
+
+int mctp_set_msg_ic(struct mctp *mctp, uint8_t msg_type, bool enable)
+{
+    uint32_t bit = (uint32_t) 1 << (msg_type % 32);
+
+    if ( msg_type & MCTP_MSG_IC_BIT )
+        return -EINVAL;
+
+    if ( enable )
+        mctp->ic_types[msg_type / 32] |= bit;
+    else
+        mctp->ic_types[msg_type / 32] &= ~bit;
+
+    return 0;
+}
+
+static struct mctp_bus *find_bus_for_eid(struct mctp *mctp, mctp_eid_t dest)
+{
+    struct mctp_bus *bus = &mctp->busses[mctp->routes[dest]];
+
+    return bus->binding ? bus : NULL;
+}
+
+static inline bool mctp_route_is_set(struct mctp *mctp, mctp_eid_t eid)
+{
+    return mctp->routes_set[eid / 32] & ((uint32_t) 1 << (eid % 32));
+}
+
+/* Create the packet pool of a binding, sized to its MTU and framing, and
+ * the context pool of the instance along with its first bus */
+static int mctp_binding_pool_init(struct mctp *mctp, struct mctp_binding *binding)
+{
+    size_t count = binding->pkt_pool_count ? binding->pkt_pool_count : MCTP_PKTBUF_POOL_COUNT;
+    size_t size;
+
+    if ( ! mctp->ctx_pool )
+    {
+        mctp->ctx_pool = mctp->alloc_ops->pool_create(mctp->alloc_data, MCTP_MSG_CTX_BUF_SIZE, MCTP_MSG_CTX_COUNT);
+        if ( ! mctp->ctx_pool )
+        {
+            mctp_prerr("No memory for %d reassembly buffers", MCTP_MSG_CTX_COUNT);
+            return -ENOMEM;
+        }
+    }
+
+    if ( binding->pkt_pool )
+        return 0;
+
+    size              = binding->pkt_size + binding->pkt_header + binding->pkt_trailer;
+    binding->pkt_pool = mctp->alloc_ops->pool_create(mctp->alloc_data, sizeof(struct mctp_pktbuf) + size, count);
+    if ( ! binding->pkt_pool )
+    {
+        mctp_prerr("No memory for %zu packets of %s binding", count, binding->name);
+        return -ENOMEM;
+    }
+
+    binding->pkt_pool_size = size;
+
+    return 0;
 }
 
 int mctp_register_bus(struct mctp *mctp, struct mctp_binding *binding, mctp_eid_t eid)
 {
-    int rc = 0;
+    struct mctp_bus *bus;
+    int              rc = 0;
+    int              i;
+
+    if ( mctp->route_policy == ROUTE_BRIDGE )
+        return -EBUSY;
+
+    for ( i = 0; i < MCTP_MAX_BUSSES && mctp->busses[i].binding; i++ )
+        ;
+
+    if ( i == MCTP_MAX_BUSSES )
+        return -ENOSPC;
+
+    rc = mctp_binding_pool_init(mctp, binding);
+    if ( rc )
+        return rc;
+
+    bus = &mctp->busses[i];
+    memset(bus, 0, sizeof(*bus));
+    bus->binding       = binding;
+    bus->eid           = eid;
+    binding->bus       = bus;
+    binding->mctp      = mctp;
+    mctp->route_policy = ROUTE_ENDPOINT;
+    if ( i >= mctp->n_busses )
+        mctp->n_busses = i + 1;
+
+    if ( binding->start )
+    {
+        rc = binding->start(binding);
+        if ( rc < 0 )
+        {
+            mctp_prerr("Failed to start binding: %d", rc);
+            binding->bus = NULL;
+            bus->binding = NULL;
+        }
+    }
+
+    return rc;
+}
+
+void mctp_unregister_bus(struct mctp *mctp, struct mctp_binding *binding)
+{
+    struct mctp_bus *bus = binding->bus;
+    unsigned int     eid;
+
+    if ( ! bus )
+        return;
+
+    /* Routes through this bus are removed, bridges flood these EIDs again */
+    for ( eid = 0; eid < ARRAY_SIZE(mctp->routes); eid++ )
+    {
+        if ( &mctp->busses[mctp->routes[eid]] == bus )
+        {
+            mctp->routes[eid] = 0;
+            mctp->routes_set[eid / 32] &= ~((uint32_t) 1 << (eid % 32));
+        }
+    }
 
-    /* todo: multiple busses */
-    assert(mctp->n_busses == 0);
-    mctp->n_busses = 1;
+    mctp_bus_destroy(bus);
+    bus->binding  = NULL;
+    binding->mctp = NULL;
+    binding->bus  = NULL;
+
+    while ( mctp->n_busses && ! mctp->busses[mctp->n_busses - 1].binding ) mctp->n_busses--;
+}
+
+int mctp_route_add(struct mctp *mctp, mctp_eid_t first, mctp_eid_t last, struct mctp_binding *binding)
+{
+    unsigned int eid;
+
+    if ( first > last || ! binding->bus || binding->mctp != mctp )
+        return -EINVAL;
+
+    for ( eid = first; eid <= last; eid++ )
+    {
+        mctp->routes[eid] = binding->bus - mctp->busses;
+        mctp->routes_set[eid / 32] |= (uint32_t) 1 << (eid % 32);
+    }
+
+    return 0;
+}
 
-    mctp->busses = hal_alloc(sizeof(struct mctp_bus));
-    if ( ! mctp->busses )
-        return -ENOMEM;
+int mctp_route_del(struct mctp *mctp, mctp_eid_t first, mctp_eid_t last)
+{
+    unsigned int eid;
 
-    memset(mctp->busses, 0, sizeof(struct mctp_bus));
-    mctp->busses[0].binding = binding;
-    mctp->busses[0].eid     = eid;
-    binding->bus            = &mctp->busses[0];
-    binding->mctp           = mctp;
-    mctp->route_policy      = ROUTE_ENDPOINT;
+    if ( first > last )
+        return -EINVAL;
 
-    if ( binding->start )
+    for ( eid = first; eid <= last; eid++ )
     {
-        rc = binding->start(binding);
-        if ( rc < 0 )
-        {
-            mctp_prerr("Failed to start binding: %d", rc);
-            binding->bus = NULL;
-            __mctp_free(mctp->busses);
-            mctp->busses   = NULL;
-            mctp->n_busses = 0;
-        }
+        mctp->routes[eid] = 0;
+        mctp->routes_set[eid / 32] &= ~((uint32_t) 1 << (eid % 32));
     }
 
-    return rc;
+    return 0;
 }
 
-void mctp_unregister_bus(struct mctp *mctp, struct mctp_binding *binding)
+struct mctp_binding *mctp_route_lookup(struct mctp *mctp, mctp_eid_t eid)
 {
-    /*
-	 * We only support one bus right now; once the call completes we will
-	 * have no more busses
-	 */
-    mctp->n_busses = 0;
-    binding->mctp  = NULL;
-    binding->bus   = NULL;
-    __mctp_free(mctp->busses);
+    struct mctp_bus *bus = find_bus_for_eid(mctp, eid);
+
+    return bus ? bus->binding : NULL;
 }
 
 int mctp_bridge_busses(struct mctp *mctp, struct mctp_binding *b1, struct mctp_binding *b2)
 {
     int rc = 0;
 
-    assert(mctp->n_busses == 0);
-    mctp->busses = __mctp_alloc(2 * sizeof(struct mctp_bus));
-    if ( ! mctp->busses )
-        return -ENOMEM;
+    BUILD_ASSERT(MCTP_MAX_BUSSES >= 2);
+
+    if ( mctp->n_busses != 0 )
+        return -EBUSY;
+
+    rc = mctp_binding_pool_init(mctp, b1);
+    if ( rc == 0 )
+        rc = mctp_binding_pool_init(mctp, b2);
+    if ( rc )
+        return rc;
+
     memset(mctp->busses, 0, 2 * sizeof(struct mctp_bus));
     mctp->n_busses          = 2;
     mctp->busses[0].binding = b1;
@@ -436,6 +1283,56 @@ done:
     return rc;
 }
 
+void mctp_set_bridge_cut_through(struct mctp *mctp, bool enable)
+{
+    mctp->bridge_store = ! enable;
+}
+
+/*
+ * Forward a bridged packet cut-through, when any packet of the binding it
+ * arrived on fits the binding it leaves on: the packet itself is queued
+ * there, with its header untouched as source, destination, tag and sequence
+ * are end to end. Deciding on the bindings rather than on the packet keeps
+ * a message whole, a short last packet is not cut through while the others
+ * are being reassembled. Returns false for the packets to be reassembled,
+ * stored and forwarded.
+ */
+static bool mctp_bridge_cut_through(struct mctp *mctp, struct mctp_bus *bus, struct mctp_pktbuf *pkt)
+{
+    struct mctp_binding *egress;
+    struct mctp_bus     *dest_bus;
+    mctp_eid_t           dest = MCTP_PKTBUF_HDR(pkt)->dest;
+
+    dest_bus = find_bus_for_eid(mctp, dest);
+    if ( ! dest_bus || dest_bus == bus )
+    {
+        /* Routed back where it came from, dropped past reassembly */
+        if ( mctp_route_is_set(mctp, dest) )
+            return false;
+
+        /* No route, the other bus of the bridge */
+        dest_bus = &mctp->busses[bus == &mctp->busses[0]];
+    }
+
+    egress = dest_bus->binding;
+    if ( ! egress || dest_bus->state == mctp_bus_state_constructed )
+        return false;
+
+    if ( bus->binding->pkt_size > egress->pkt_size || bus->binding->pkt_header < egress->pkt_header ||
+         bus->binding->pkt_trailer < egress->pkt_trailer )
+        return false;
+
+    pkt->start   = pkt->mctp_hdr_off;
+    pkt->next    = NULL;
+    pkt->ext_len = 0;
+    pkt->done    = NULL;
+
+    mctp->stats.bridge_cut++;
+    mctp_bus_enqueue(dest_bus, pkt, pkt, 1);
+
+    return true;
+}
+
 static inline bool mctp_ctrl_cmd_is_transport(struct mctp_ctrl_msg_hdr *hdr)
 {
     return ((hdr->command_code >= MCTP_CTRL_CMD_FIRST_TRANSPORT) && (hdr->command_code <= MCTP_CTRL_CMD_LAST_TRANSPORT));
@@ -469,6 +1366,74 @@ static bool mctp_ctrl_handle_msg(struct mctp_bus *bus, mctp_eid_t src, uint8_t m
     return false;
 }
 
+/*
+ * Answer a control request of the built-in responder. The response is a
+ * single packet, its template copied in place and patched, queued on the
+ * bus the request came from; the request goes on to the callbacks when the
+ * command is not handled here or no packet is free.
+ */
+static bool mctp_ctrl_respond(struct mctp *mctp, struct mctp_bus *bus, mctp_eid_t src, uint8_t msg_tag, const uint8_t *buf, size_t len)
+{
+    const struct mctp_ctrl_msg_hdr *req = (const struct mctp_ctrl_msg_hdr *) buf;
+    const struct mctp_ctrl_tmpl    *tmpl;
+    struct mctp_ctrl_msg_hdr       *resp;
+    struct mctp_pktbuf             *pkt;
+    struct mctp_hdr                *hdr;
+
+    switch ( req->command_code )
+    {
+        case MCTP_CTRL_CMD_GET_ENDPOINT_ID:
+            tmpl = &mctp->ctrl_tmpls[MCTP_CTRL_TMPL_EID];
+            break;
+
+        case MCTP_CTRL_CMD_GET_ENDPOINT_UUID:
+            tmpl = &mctp->ctrl_tmpls[MCTP_CTRL_TMPL_UUID];
+            break;
+
+        case MCTP_CTRL_CMD_GET_VERSION_SUPPORT:
+            /* The versions of the other message types are the application's */
+            if ( len <= MCTP_CTRL_REQ_HDR_SIZE )
+                return false;
+            if ( buf[MCTP_CTRL_REQ_HDR_SIZE] != MCTP_CTRL_HDR_MSG_TYPE && buf[MCTP_CTRL_REQ_HDR_SIZE] != MCTP_CTRL_VERSION_TYPE_BASE )
+                return false;
+
+            tmpl = &mctp->ctrl_tmpls[MCTP_CTRL_TMPL_VERSION];
+            break;
+
+        case MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT:
+            tmpl = &mctp->ctrl_tmpls[MCTP_CTRL_TMPL_TYPES];
+            break;
+
+        default:
+            return false;
+    }
+
+    if ( ! tmpl->len )
+        return false;
+
+    pkt = mctp_pktbuf_alloc(bus->binding, sizeof(*hdr) + tmpl->len);
+    if ( ! pkt )
+        return false;
+
+    hdr                = MCTP_PKTBUF_HDR(pkt);
+    hdr->ver           = bus->binding->version & 0xf;
+    hdr->dest          = src;
+    hdr->src           = bus->eid;
+    hdr->flags_seq_tag = MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | (msg_tag << MCTP_HDR_TAG_SHIFT);
+
+    resp = (struct mctp_ctrl_msg_hdr *) MCTP_PKTBUF_DATA(pkt);
+    memcpy(resp, tmpl->msg, tmpl->len);
+    resp->rq_dgram_inst = req->rq_dgram_inst & MCTP_CTRL_HDR_INSTANCE_ID_MASK;
+
+    if ( req->command_code == MCTP_CTRL_CMD_GET_ENDPOINT_ID )
+        *(uint8_t *) (resp + 1) = bus->eid;
+
+    mctp->stats.ctrl_responses++;
+    mctp_bus_enqueue(bus, pkt, pkt, 1);
+
+    return true;
+}
+
 static inline bool mctp_rx_dest_is_local(struct mctp_bus *bus, mctp_eid_t dest)
 {
     return dest == bus->eid || dest == MCTP_EID_NULL || dest == MCTP_EID_BROADCAST;
@@ -490,8 +1455,20 @@ static void mctp_rx(struct mctp *mctp, struct mctp_bus *bus, mctp_eid_t src, mct
 
     if ( mctp->route_policy == ROUTE_ENDPOINT && mctp_rx_dest_is_local(bus, dest) )
     {
+        /* Responses go to their request */
+        if ( mctp_req_is_response(mctp, src, tag_owner, msg_tag) )
+        {
+            struct mctp_req *req = mctp_req_lookup(mctp, src, msg_tag);
+
+            if ( req )
+            {
+                mctp_req_complete(mctp, req, buf, len);
+                return;
+            }
+        }
+
         /* Handle MCTP Control Messages: */
-        if ( len >= sizeof(struct mctp_ctrl_msg_hdr) )
+        if ( len >= MCTP_CTRL_REQ_HDR_SIZE )
         {
             struct mctp_ctrl_msg_hdr *msg_hdr = buf;
 
@@ -502,7 +1479,8 @@ static void mctp_rx(struct mctp *mctp, struct mctp_bus *bus, mctp_eid_t src, mct
             if ( mctp_ctrl_cmd_is_request(msg_hdr) )
             {
                 bool handled;
-                handled = mctp_ctrl_handle_msg(bus, src, msg_tag, tag_owner, buf, len);
+                handled = (tag_owner && mctp_ctrl_respond(mctp, bus, src, msg_tag, buf, len)) ||
+                          mctp_ctrl_handle_msg(bus, src, msg_tag, tag_owner, buf, len);
                 if ( handled )
                     return;
             }
@@ -514,12 +1492,24 @@ static void mctp_rx(struct mctp *mctp, struct mctp_bus *bus, mctp_eid_t src, mct
 
     if ( mctp->route_policy == ROUTE_BRIDGE )
     {
-        int i;
+        struct mctp_bus *dest_bus = find_bus_for_eid(mctp, dest);
+        int              i;
+
+        if ( dest_bus && dest_bus != bus )
+        {
+            mctp_message_tx_on_bus(dest_bus, src, dest, tag_owner, msg_tag, buf, len);
+            return;
+        }
+
+        /* Routed back where it came from */
+        if ( mctp_route_is_set(mctp, dest) )
+            return;
 
+        /* No route, flood the other busses */
         for ( i = 0; i < mctp->n_busses; i++ )
         {
-            struct mctp_bus *dest_bus = &mctp->busses[i];
-            if ( dest_bus == bus )
+            dest_bus = &mctp->busses[i];
+            if ( dest_bus == bus || ! dest_bus->binding )
                 continue;
 
             mctp_message_tx_on_bus(dest_bus, src, dest, tag_owner, msg_tag, buf, len);
@@ -527,17 +1517,53 @@ static void mctp_rx(struct mctp *mctp, struct mctp_bus *bus, mctp_eid_t src, mct
     }
 }
 
-void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+/*
+ * Whether a message starting with 'payload' is delivered scattered over its
+ * packets. Control messages are always reassembled in a buffer since the
+ * core parses them in place, and so are responses to our requests.
+ */
+static inline bool mctp_rx_scatter(struct mctp *mctp, const struct mctp_hdr *hdr, bool tag_owner, uint8_t tag, const uint8_t *payload)
 {
-    struct mctp_bus     *bus  = binding->bus;
-    struct mctp         *mctp = binding->mctp;
-    uint8_t              flags, exp_seq, seq, tag;
-    struct mctp_msg_ctx *ctx;
-    struct mctp_hdr     *hdr;
-    bool                 tag_owner;
-    size_t               len;
-    void                *p;
-    int                  rc;
+    return mctp->message_rx_pkts && mctp->route_policy == ROUTE_ENDPOINT && (payload[0] & ~MCTP_MSG_IC_BIT) != MCTP_CTRL_HDR_MSG_TYPE &&
+           ! mctp_req_is_response(mctp, hdr->src, tag_owner, tag);
+}
+
+/*
+ * Handler of a message starting with 'payload' when its type is streamed.
+ * Responses to our requests are left to the request.
+ */
+static inline const struct mctp_rx_stream *mctp_rx_stream_lookup(struct mctp *mctp, const struct mctp_hdr *hdr, bool tag_owner, uint8_t tag,
+                                                                 const uint8_t *payload)
+{
+    uint8_t type = payload[0] & ~MCTP_MSG_IC_BIT;
+    size_t  i;
+
+    if ( ! (mctp->rx_stream_types[type / 32] & ((uint32_t) 1 << (type % 32))) || mctp->route_policy != ROUTE_ENDPOINT ||
+         mctp_req_is_response(mctp, hdr->src, tag_owner, tag) )
+        return NULL;
+
+    for ( i = 0; i < ARRAY_SIZE(mctp->rx_streams); i++ )
+    {
+        if ( mctp->rx_streams[i].fn && mctp->rx_streams[i].type == type )
+            return &mctp->rx_streams[i];
+    }
+
+    return NULL;
+}
+
+/* Receive one packet. '*last' holds the context the previous packet of a
+ * batch was added to, which spares the lookup of the packets continuing
+ * its message; it is updated for the next packet */
+static void mctp_bus_rx_pkt(struct mctp_bus *bus, struct mctp *mctp, struct mctp_pktbuf *pkt, struct mctp_msg_ctx **last)
+{
+    uint8_t                      flags, exp_seq, seq, tag;
+    const struct mctp_rx_stream *stream;
+    struct mctp_msg_ctx         *ctx;
+    struct mctp_hdr             *hdr;
+    bool                         tag_owner, scatter;
+    size_t                       len;
+    void                        *p;
+    int                          rc;
 
 #ifdef DEBUG
 
@@ -551,27 +1577,64 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
         mctp->capture(pkt, MCTP_MESSAGE_CAPTURE_INCOMING, mctp->capture_data);
 #endif
 
+    if ( mctp->capture_ring )
+        mctp_capture_ring_put(mctp->capture_ring, pkt, MCTP_MESSAGE_CAPTURE_INCOMING);
+
+    if ( mctp->route_policy == ROUTE_BRIDGE && ! mctp->bridge_store && mctp_bridge_cut_through(mctp, bus, pkt) )
+        return;
+
     // hdr = mctp_pktbuf_hdr(pkt);
 
     hdr = MCTP_PKTBUF_HDR(pkt);
 
-    /* Small optimisation: don't bother reassembly if we're going to
-	 * drop the packet in mctp_rx anyway */
-    if ( mctp->route_policy == ROUTE_ENDPOINT && ! mctp_rx_dest_is_local(bus, hdr->dest) )
-        goto out;
-
     flags     = hdr->flags_seq_tag & (MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM);
     tag       = (hdr->flags_seq_tag >> MCTP_HDR_TAG_SHIFT) & MCTP_HDR_TAG_MASK;
     seq       = (hdr->flags_seq_tag >> MCTP_HDR_SEQ_SHIFT) & MCTP_HDR_SEQ_MASK;
     tag_owner = (hdr->flags_seq_tag >> MCTP_HDR_TO_SHIFT) & MCTP_HDR_TO_MASK;
 
+    /* The context of a message passed the destination check on its SOM. It
+     * is only trusted while still in use, with the same key */
+    ctx   = *last;
+    *last = NULL;
+    if ( ! ctx || ! mctp_msg_ctx_in_use(mctp, ctx) || (flags & MCTP_HDR_FLAG_SOM) || ctx->src != hdr->src || ctx->dest != hdr->dest ||
+         ctx->tag != tag )
+    {
+        ctx = NULL;
+
+        /* Small optimisation: don't bother reassembly if we're going to
+         * drop the packet in mctp_rx anyway */
+        if ( mctp->route_policy == ROUTE_ENDPOINT && ! mctp_rx_dest_is_local(bus, hdr->dest) )
+            goto out;
+    }
+
     switch ( flags )
     {
         case MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM:
             /* single-packet message - send straight up to rx function,
 		 * no need to create a message context */
-            len = pkt->end - pkt->mctp_hdr_off - sizeof(struct mctp_hdr);
-            p   = pkt->data + pkt->mctp_hdr_off + sizeof(struct mctp_hdr);
+            len     = pkt->end - pkt->mctp_hdr_off - sizeof(struct mctp_hdr);
+            p       = pkt->data + pkt->mctp_hdr_off + sizeof(struct mctp_hdr);
+            stream  = len ? mctp_rx_stream_lookup(mctp, hdr, tag_owner, tag, p) : NULL;
+            scatter = len && ! stream && mctp_rx_scatter(mctp, hdr, tag_owner, tag, p);
+#if ( MCTP_MESSAGE_IC > 0 )
+            if ( len && mctp_msg_ic(mctp, *(uint8_t *) p) && mctp_msg_ic_verify(p, &len, 0, 0) )
+                goto out;
+#endif
+            if ( stream )
+            {
+                stream->fn(hdr->src, tag_owner, tag, stream->data, MCTP_RX_STREAM_SOM | MCTP_RX_STREAM_EOM, p, len);
+                break;
+            }
+
+            if ( scatter )
+            {
+                /* Hand over the packet itself, less any trailer */
+                pkt->end  = pkt->mctp_hdr_off + sizeof(struct mctp_hdr) + len;
+                pkt->next = NULL;
+                mctp->message_rx_pkts(hdr->src, tag_owner, tag, mctp->message_rx_pkts_data, pkt, len);
+                break;
+            }
+
             mctp_rx(mctp, bus, hdr->src, hdr->dest, tag_owner, tag, p, len);
             break;
 
@@ -579,19 +1642,29 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
             /* start of a new message - start the new context for
 		 * future message reception. If an existing context is
 		 * already present, drop it. */
-            ctx = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
+            stream  = MCTP_PKTBUF_SIZE(pkt) > sizeof(struct mctp_hdr) ? mctp_rx_stream_lookup(mctp, hdr, tag_owner, tag, MCTP_PKTBUF_DATA(pkt)) : NULL;
+            scatter = MCTP_PKTBUF_SIZE(pkt) > sizeof(struct mctp_hdr) && ! stream && mctp_rx_scatter(mctp, hdr, tag_owner, tag, MCTP_PKTBUF_DATA(pkt));
+            ctx     = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
+            if ( ctx && (ctx->scatter != scatter || ctx->stream || stream) )
+            {
+                mctp_msg_ctx_drop(mctp, ctx);
+                ctx = NULL;
+            }
+
             if ( ctx )
             {
                 mctp_msg_ctx_reset(ctx);
+                mctp_msg_ctx_arm(mctp, ctx);
             }
             else
             {
-                ctx = mctp_msg_ctx_create(mctp, hdr->src, hdr->dest, tag);
+                ctx = mctp_msg_ctx_create(mctp, hdr->src, hdr->dest, tag, scatter, stream);
                 /* If context creation fails due to exhaution of contexts we
 			* can support, drop the packet */
                 if ( ! ctx )
                 {
                     mctp_prdebug("Context buffers exhausted.");
+                    mctp->stats.rx_ctx_exhausted++;
                     goto out;
                 }
             }
@@ -599,21 +1672,39 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
             /* Save the fragment size, subsequent middle fragments
 		 * should of the same size */
             ctx->fragment_size = MCTP_PKTBUF_SIZE(pkt);
+            ctx->ic            = MCTP_PKTBUF_SIZE(pkt) > sizeof(struct mctp_hdr) && mctp_msg_ic(mctp, *(uint8_t *) MCTP_PKTBUF_DATA(pkt));
+
+            if ( ctx->stream )
+            {
+                ctx->tag_owner = tag_owner;
+                rc             = mctp_rx_stream_pkt(ctx, pkt, MCTP_RX_STREAM_SOM);
+
+                /* The handler may have stopped streaming the type */
+                if ( ! rc && ! mctp_msg_ctx_in_use(mctp, ctx) )
+                    break;
+            }
+            else
+            {
+                rc = mctp_msg_ctx_add_pkt(ctx, pkt, mctp->max_message_size);
+            }
 
-            rc = mctp_msg_ctx_add_pkt(ctx, pkt, mctp->max_message_size);
             if ( rc )
             {
-                mctp_msg_ctx_drop(ctx);
+                mctp_msg_ctx_drop(mctp, ctx);
             }
             else
             {
                 ctx->last_seq = seq;
+                *last         = ctx;
+                if ( ctx->scatter )
+                    pkt = NULL;
             }
 
             break;
 
         case MCTP_HDR_FLAG_EOM:
-            ctx = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
+            if ( ! ctx )
+                ctx = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
             if ( ! ctx )
                 goto out;
 
@@ -622,7 +1713,7 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
             if ( exp_seq != seq )
             {
                 mctp_prdebug("Sequence number %d does not match expected %d", seq, exp_seq);
-                mctp_msg_ctx_drop(ctx);
+                mctp_msg_ctx_drop(mctp, ctx);
                 goto out;
             }
 
@@ -633,20 +1724,44 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
                 mctp_prdebug("Unexpected fragment size. Expected"
                              " less than %zu, received = %zu",
                              ctx->fragment_size, len);
-                mctp_msg_ctx_drop(ctx);
+                mctp_msg_ctx_drop(mctp, ctx);
                 goto out;
             }
 
+            if ( ctx->stream )
+            {
+                /* Complete once delivered, there is nothing left to abandon */
+                if ( ! mctp_rx_stream_pkt(ctx, pkt, MCTP_RX_STREAM_EOM) )
+                    ctx->stream = NULL;
+
+                /* Unless the handler already dropped it */
+                if ( mctp_msg_ctx_in_use(mctp, ctx) )
+                    mctp_msg_ctx_drop(mctp, ctx);
+                break;
+            }
+
             rc = mctp_msg_ctx_add_pkt(ctx, pkt, mctp->max_message_size);
-            if ( ! rc )
+            if ( ! rc && ctx->scatter )
+                pkt = NULL;
+#if ( MCTP_MESSAGE_IC > 0 )
+            if ( ! rc && ctx->ic && ctx->scatter )
+                rc = mctp_msg_ic_verify_pkts(ctx->pkts, &ctx->buf_size);
+            else if ( ! rc && ctx->ic )
+                rc = mctp_msg_ic_verify(ctx->buf, &ctx->buf_size, ctx->ic_crc, ctx->ic_done);
+#endif
+            /* Scattered packets return to the pool once the callback is done */
+            if ( ! rc && ctx->scatter )
+                mctp->message_rx_pkts(ctx->src, tag_owner, tag, mctp->message_rx_pkts_data, ctx->pkts, ctx->buf_size);
+            else if ( ! rc )
                 mctp_rx(mctp, bus, ctx->src, ctx->dest, tag_owner, tag, ctx->buf, ctx->buf_size);
 
-            mctp_msg_ctx_drop(ctx);
+            mctp_msg_ctx_drop(mctp, ctx);
             break;
 
         case 0:
             /* Neither SOM nor EOM */
-            ctx = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
+            if ( ! ctx )
+                ctx = mctp_msg_ctx_lookup(mctp, hdr->src, hdr->dest, tag);
             if ( ! ctx )
                 goto out;
 
@@ -654,7 +1769,7 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
             if ( exp_seq != seq )
             {
                 mctp_prdebug("Sequence number %d does not match expected %d", seq, exp_seq);
-                mctp_msg_ctx_drop(ctx);
+                mctp_msg_ctx_drop(mctp, ctx);
                 goto out;
             }
 
@@ -665,22 +1780,54 @@ void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
                 mctp_prdebug("Unexpected fragment size. Expected = %zu "
                              "received = %zu",
                              ctx->fragment_size, len);
-                mctp_msg_ctx_drop(ctx);
+                mctp_msg_ctx_drop(mctp, ctx);
                 goto out;
             }
 
-            rc = mctp_msg_ctx_add_pkt(ctx, pkt, mctp->max_message_size);
+            rc = ctx->stream ? mctp_rx_stream_pkt(ctx, pkt, 0) : mctp_msg_ctx_add_pkt(ctx, pkt, mctp->max_message_size);
             if ( rc )
             {
                 mctp_prdebug("Could not append frgament to coontext, dropping context");
+                mctp_msg_ctx_drop(mctp, ctx);
                 goto out;
             }
+
+            /* The stream handler may have stopped streaming the type */
+            if ( ! mctp_msg_ctx_in_use(mctp, ctx) )
+                goto out;
             ctx->last_seq = seq;
+            *last         = ctx;
+            if ( ctx->scatter )
+                pkt = NULL;
 
             break;
     }
 out:
-    __mctp_free(pkt);
+    /* Packets kept by a scattered context are released with it */
+    if ( pkt )
+        mctp_pktbuf_release(pkt);
+}
+
+void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+{
+    struct mctp_msg_ctx *last = NULL;
+
+    mctp_bus_rx_pkt(binding->bus, binding->mctp, pkt, &last);
+}
+
+void mctp_bus_rx_batch(struct mctp_binding *binding, struct mctp_pktbuf *pkts, size_t n)
+{
+    struct mctp_bus     *bus  = binding->bus;
+    struct mctp         *mctp = binding->mctp;
+    struct mctp_msg_ctx *last = NULL;
+    struct mctp_pktbuf  *next;
+
+    for ( ; n && pkts; n--, pkts = next )
+    {
+        /* The packet may be kept, relinked, by a scattered context */
+        next = pkts->next;
+        mctp_bus_rx_pkt(bus, mctp, pkts, &last);
+    }
 }
 
 static int mctp_packet_tx(struct mctp_bus *bus, struct mctp_pktbuf *pkt)
@@ -693,13 +1840,66 @@ static int mctp_packet_tx(struct mctp_bus *bus, struct mctp_pktbuf *pkt)
     if ( mctp->capture )
         mctp->capture(pkt, MCTP_MESSAGE_CAPTURE_OUTGOING, mctp->capture_data);
 
+    if ( mctp->capture_ring )
+        mctp_capture_ring_put(mctp->capture_ring, pkt, MCTP_MESSAGE_CAPTURE_OUTGOING);
+
     return bus->binding->tx(bus->binding, pkt);
 }
 
+/* Hand the binding as many queued packets as it takes in one go */
+static int mctp_packet_tx_batch(struct mctp_bus *bus)
+{
+    struct mctp        *mctp = bus->binding->mctp;
+    struct mctp_pktbuf *pkt;
+    int                 rc, i;
+
+    if ( bus->state != mctp_bus_state_tx_enabled )
+        return -1;
+
+    rc = bus->binding->tx_batch(bus->binding, bus->tx_queue_head, bus->tx_queue_len);
+    if ( rc <= 0 )
+        return rc ? rc : -EBUSY;
+
+    /* The binding cannot have sent more than it was given. The queue is
+     * left untouched, so the packets are handed to it again on the next
+     * flush */
+    if ( (size_t) rc > bus->tx_queue_len )
+    {
+        mctp_prerr("%s binding sent %d packets out of %zu", bus->binding->name, rc, bus->tx_queue_len);
+        assert(0);
+        return -EINVAL;
+    }
+
+    for ( i = 0; i < rc; i++ )
+    {
+        pkt                = bus->tx_queue_head;
+        bus->tx_queue_head = pkt->next;
+        bus->tx_queue_len--;
+
+        if ( mctp->capture )
+            mctp->capture(pkt, MCTP_MESSAGE_CAPTURE_OUTGOING, mctp->capture_data);
+
+        if ( mctp->capture_ring )
+            mctp_capture_ring_put(mctp->capture_ring, pkt, MCTP_MESSAGE_CAPTURE_OUTGOING);
+
+        mctp_pktbuf_free(pkt);
+    }
+
+    return 0;
+}
+
 static void mctp_send_tx_queue(struct mctp_bus *bus)
 {
     struct mctp_pktbuf *pkt;
 
+    if ( bus->binding->tx_batch )
+    {
+        while ( bus->tx_queue_head && ! mctp_packet_tx_batch(bus) )
+            ;
+
+        goto cleanup_tail;
+    }
+
     while ( (pkt = bus->tx_queue_head) )
     {
         int rc;
@@ -713,6 +1913,7 @@ static void mctp_send_tx_queue(struct mctp_bus *bus)
             case -EMSGSIZE:
                 /* Drop the packet */
                 bus->tx_queue_head = pkt->next;
+                bus->tx_queue_len--;
                 mctp_pktbuf_free(pkt);
                 break;
 
@@ -730,6 +1931,19 @@ cleanup_tail:
         bus->tx_queue_tail = NULL;
 }
 
+/* Append the 'n' packets from 'head' to 'tail' to the TX queue and send */
+static void mctp_bus_enqueue(struct mctp_bus *bus, struct mctp_pktbuf *head, struct mctp_pktbuf *tail, size_t n)
+{
+    if ( bus->tx_queue_tail )
+        bus->tx_queue_tail->next = head;
+    else
+        bus->tx_queue_head = head;
+    bus->tx_queue_tail = tail;
+    bus->tx_queue_len += n;
+
+    mctp_send_tx_queue(bus);
+}
+
 void mctp_binding_set_tx_enabled(struct mctp_binding *binding, bool enable)
 {
     struct mctp_bus *bus = binding->bus;
@@ -746,6 +1960,13 @@ void mctp_binding_set_tx_enabled(struct mctp_binding *binding, bool enable)
                 return;
             }
 
+            /* The packets would not fit the pool created for the former MTU */
+            if ( binding->pkt_size + binding->pkt_header + binding->pkt_trailer > binding->pkt_pool_size )
+            {
+                mctp_prerr("Cannot start %s binding, MTU %zu exceeds its packet pool", binding->name, MCTP_BODY_SIZE(binding->pkt_size));
+                return;
+            }
+
             bus->state = mctp_bus_state_tx_enabled;
             mctp_prinfo("%s binding started", binding->name);
             return;
@@ -767,12 +1988,27 @@ void mctp_binding_set_tx_enabled(struct mctp_binding *binding, bool enable)
     }
 }
 
-static int mctp_message_tx_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid_t dest, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len)
+/*
+ * Packetize a message gathered from 'iov'. When 'done' is given and the
+ * binding can gather, the payload of a packet that lies within a single iov
+ * entry is left in place and referenced by the packet, and 'done' is called
+ * once the last packet is released. Otherwise the payload is copied.
+ */
+static int mctp_message_txv_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid_t dest, bool tag_owner, uint8_t msg_tag,
+                                   const struct mctp_iov *iov, size_t iovcnt, mctp_tx_done_fn done, void *done_arg)
 {
-    size_t              max_payload_len, payload_len, p;
-    struct mctp_pktbuf *pkt;
+    size_t              max_payload_len, payload_len, copy_len, msg_len, total_len, p, off, n, seg_off;
+    struct mctp_pktbuf *pkt, *head = NULL, *tail = NULL;
+    const uint8_t      *seg;
     struct mctp_hdr    *hdr;
+    struct mctp_hdr     hdr_template;
+    uint8_t            *data;
+    bool                gather;
     int                 i;
+#if ( MCTP_MESSAGE_IC > 0 )
+    uint8_t  ic[MCTP_MSG_IC_SIZE];
+    uint32_t ic_crc = 0;
+#endif
 
     if ( bus->state == mctp_bus_state_constructed )
         return -ENXIO;
@@ -789,63 +2025,214 @@ static int mctp_message_tx_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid
             return -EINVAL;
     }
 
+    /* Skip leading empty entries, the first byte holds the message type */
+    for ( ; iovcnt && ! iov->len; iov++, iovcnt-- )
+        ;
+
+    for ( msg_len = 0, i = 0; i < (int) iovcnt; i++ ) msg_len += iov[i].len;
+
     mctp_prdebug("%s: Generating packets for transmission of %zu byte message from %hhu to %hhu", __func__, msg_len, src, dest);
 
-    /* queue up packets, each of max MCTP_MTU size */
-    for ( p = 0, i = 0; p < msg_len; i++ )
+    /* The header only differs by its flags and sequence across packets */
+    hdr_template.ver           = bus->binding->version & 0xf;
+    hdr_template.dest          = dest;
+    hdr_template.src           = src;
+    hdr_template.flags_seq_tag = (tag_owner << MCTP_HDR_TO_SHIFT) | (msg_tag << MCTP_HDR_TAG_SHIFT);
+
+    total_len = msg_len;
+    gather    = done && bus->binding->tx_gather;
+    seg       = msg_len ? iov->base : NULL;
+    seg_off   = 0;
+
+#if ( MCTP_MESSAGE_IC > 0 )
+    /* The integrity check trailer follows the message, possibly in a
+     * packet of its own */
+    if ( msg_len && mctp_msg_ic(bus->binding->mctp, *seg) )
+        total_len += MCTP_MSG_IC_SIZE;
+#endif
+
+    /* Build the packets aside, so that a failure leaves nothing queued */
+    for ( p = 0, i = 0; p < total_len; i++ )
     {
-        payload_len = msg_len - p;
+        payload_len = total_len - p;
         if ( payload_len > max_payload_len )
             payload_len = max_payload_len;
 
         pkt = mctp_pktbuf_alloc(bus->binding, payload_len + sizeof(*hdr));
+        if ( ! pkt )
+        {
+            mctp_pktbuf_free_list(head);
+            return -ENOMEM;
+        }
+
         hdr = MCTP_PKTBUF_HDR(pkt);
 
-        hdr->ver           = bus->binding->version & 0xf;
-        hdr->dest          = dest;
-        hdr->src           = src;
-        hdr->flags_seq_tag = (tag_owner << MCTP_HDR_TO_SHIFT) | (msg_tag << MCTP_HDR_TAG_SHIFT);
+        HAL_COPY_CONST(hdr, &hdr_template, 4);
 
         if ( i == 0 )
             hdr->flags_seq_tag |= MCTP_HDR_FLAG_SOM;
-        if ( p + payload_len >= msg_len )
+        if ( p + payload_len >= total_len )
             hdr->flags_seq_tag |= MCTP_HDR_FLAG_EOM;
         hdr->flags_seq_tag |= (i & MCTP_HDR_SEQ_MASK) << MCTP_HDR_SEQ_SHIFT;
 
-        memcpy(MCTP_PKTBUF_DATA(pkt), (uint8_t *) msg + p, payload_len);
+        data     = MCTP_PKTBUF_DATA(pkt);
+        copy_len = (p < msg_len) ? MIN(payload_len, msg_len - p) : 0;
+
+        for ( off = 0; off < copy_len; off += n )
+        {
+            if ( seg_off == iov->len )
+            {
+                do
+                    iov++;
+                while ( ! iov->len );
+
+                seg     = iov->base;
+                seg_off = 0;
+            }
+
+            n = MIN(iov->len - seg_off, copy_len - off);
+
+            /* The remainder of the packet lies within this entry */
+            if ( gather && off + n == payload_len && n >= MCTP_TX_GATHER_MIN )
+            {
+                pkt->ext_data = seg + seg_off;
+                pkt->ext_len  = n;
+                pkt->end -= n;
+            }
+            else
+            {
+                memcpy(data + off, seg + seg_off, n);
+            }
+
+#if ( MCTP_MESSAGE_IC > 0 )
+            /* Checksum the span just visited, no second pass over the message */
+            if ( total_len != msg_len )
+                ic_crc = crc32c_update(ic_crc, seg + seg_off, n);
+#endif
+            seg_off += n;
+        }
+
+#if ( MCTP_MESSAGE_IC > 0 )
+        if ( copy_len < payload_len )
+        {
+            mctp_msg_ic_store(ic, ic_crc);
+            memcpy(data + copy_len, ic + (p + copy_len - msg_len), payload_len - copy_len);
+        }
+#endif
 
-        /* add to tx queue */
-        if ( bus->tx_queue_tail )
-            bus->tx_queue_tail->next = pkt;
+        if ( tail )
+            tail->next = pkt;
         else
-            bus->tx_queue_head = pkt;
-        bus->tx_queue_tail = pkt;
+            head = pkt;
+        tail = pkt;
 
         p += payload_len;
     }
 
     mctp_prdebug("%s: Enqueued %d packets", __func__, i);
 
-    mctp_send_tx_queue(bus);
+    if ( ! tail )
+    {
+        /* Nothing to send */
+        if ( done )
+            done(done_arg);
+
+        return 0;
+    }
+
+    /* Packets are released in order, the last one completes the message */
+    if ( done )
+    {
+        tail->done     = done;
+        tail->done_arg = done_arg;
+    }
+
+    mctp_bus_enqueue(bus, head, tail, i);
 
     return 0;
 }
 
+static int mctp_message_tx_on_bus(struct mctp_bus *bus, mctp_eid_t src, mctp_eid_t dest, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len)
+{
+    struct mctp_iov iov = {msg, msg_len};
+
+    return mctp_message_txv_on_bus(bus, src, dest, tag_owner, msg_tag, &iov, 1, NULL, NULL);
+}
+
 int mctp_message_tx(struct mctp *mctp, mctp_eid_t eid, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len)
 {
     struct mctp_bus *bus;
 
-    /* TODO: Protect against same tag being used across
-	 * different callers */
     if ( (msg_tag & MCTP_HDR_TAG_MASK) != msg_tag )
     {
         mctp_prerr("Incorrect message tag %u passed.", msg_tag);
         return -EINVAL;
     }
 
+    if ( tag_owner && (mctp->req_tags[eid] & (1 << msg_tag)) )
+        return -EBUSY;
+
     bus = find_bus_for_eid(mctp, eid);
     if ( ! bus )
         return 0;
 
     return mctp_message_tx_on_bus(bus, bus->eid, eid, tag_owner, msg_tag, msg, msg_len);
 }
+
+int mctp_message_request(struct mctp *mctp, mctp_eid_t eid, void *msg, size_t msg_len, mctp_resp_fn fn, void *data)
+{
+    struct mctp_req *req;
+    struct mctp_bus *bus;
+    uint8_t          tag;
+    int              rc;
+
+    if ( mctp->req_tags[eid] == 0xff || mctp->req_used == (uint32_t) -1 >> (32 - MCTP_REQ_COUNT) )
+        return -EBUSY;
+
+    bus = find_bus_for_eid(mctp, eid);
+    if ( ! bus )
+        return -EHOSTUNREACH;
+
+    /* Taken before sending, the response may arrive before we return */
+    tag            = __builtin_ctz(~mctp->req_tags[eid]);
+    req            = &mctp->reqs[__builtin_ctz(~mctp->req_used)];
+    req->eid       = eid;
+    req->tag       = tag;
+    req->deadline  = mctp_req_deadline(mctp);
+    req->fn        = fn;
+    req->data      = data;
+    mctp->req_tags[eid] |= 1 << tag;
+    mctp->req_used |= (uint32_t) 1 << (req - mctp->reqs);
+
+    /* Nothing went out on failure */
+    rc = mctp_message_tx_on_bus(bus, bus->eid, eid, true, tag, msg, msg_len);
+    if ( rc )
+    {
+        mctp->req_tags[eid] &= ~(1 << tag);
+        mctp->req_used &= ~((uint32_t) 1 << (req - mctp->reqs));
+        return rc;
+    }
+
+    return tag;
+}
+
+int mctp_message_txv(struct mctp *mctp, mctp_eid_t eid, bool tag_owner, uint8_t msg_tag, const struct mctp_iov *iov, size_t iovcnt, mctp_tx_done_fn done,
+                     void *done_arg)
+{
+    struct mctp_bus *bus;
+
+    if ( (msg_tag & MCTP_HDR_TAG_MASK) != msg_tag )
+    {
+        mctp_prerr("Incorrect message tag %u passed.", msg_tag);
+        return -EINVAL;
+    }
+
+    if ( tag_owner && (mctp->req_tags[eid] & (1 << msg_tag)) )
+        return -EBUSY;
+
+    bus = find_bus_for_eid(mctp, eid);
+    if ( ! bus )
+        return -EHOSTUNREACH;
+
+    return mctp_message_txv_on_bus(bus, bus->eid, eid, tag_owner, msg_tag, iov, iovcnt, done, done_arg);
+}
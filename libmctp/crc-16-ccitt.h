@@ -11,4 +11,30 @@ uint16_t crc_16_ccitt(uint16_t fcs, const uint8_t *cp, uint32_t len);
 
 uint16_t crc_16_ccitt_byte(uint16_t fcs, const uint8_t c);
 
+/* Streaming API, for callers that see the data in several spans */
+struct crc_16_ccitt_ctx
+{
+    uint16_t fcs;
+};
+
+static inline void crc_16_ccitt_init(struct crc_16_ccitt_ctx *ctx)
+{
+    ctx->fcs = FCS_INIT_16;
+}
+
+static inline void crc_16_ccitt_update(struct crc_16_ccitt_ctx *ctx, const uint8_t *cp, uint32_t len)
+{
+    ctx->fcs = crc_16_ccitt(ctx->fcs, cp, len);
+}
+
+static inline void crc_16_ccitt_update_byte(struct crc_16_ccitt_ctx *ctx, const uint8_t c)
+{
+    ctx->fcs = crc_16_ccitt_byte(ctx->fcs, c);
+}
+
+static inline uint16_t crc_16_ccitt_final(const struct crc_16_ccitt_ctx *ctx)
+{
+    return ctx->fcs;
+}
+
 #endif
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+#ifndef _CRC_PROFILE_H
+#define _CRC_PROFILE_H
+
+/*
+ * CRC lookup table profiles, trading table size for throughput. The tables
+ * are generated by resources/crc_tables.py.
+ *
+ * NIBBLE: 16 entries per CRC, two lookups per byte, for ROM constrained
+ *         builds.
+ * BYTE:   256 entries per CRC, one lookup per byte.
+ * SLICE:  slicing tables, 4 bytes (CRC-16) or 8 bytes (CRC-32) per
+ *         iteration.
+ */
+#define MCTP_CRC_PROFILE_NIBBLE 0
+#define MCTP_CRC_PROFILE_BYTE   1
+#define MCTP_CRC_PROFILE_SLICE  2
+
+#ifndef MCTP_CRC_PROFILE
+#define MCTP_CRC_PROFILE MCTP_CRC_PROFILE_SLICE
+#endif
+
+#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_NIBBLE )
+#define MCTP_CRC_PROFILE_NAME "nibble"
+#elif ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_BYTE )
+#define MCTP_CRC_PROFILE_NAME "byte"
+#elif ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_SLICE )
+#define MCTP_CRC_PROFILE_NAME "slicing"
+#else
+#error "Unknown MCTP_CRC_PROFILE"
+#endif
+
+#endif
@@ -2,24 +2,250 @@
 /* Copyright 2021 IBM Corp. */
 
 #include "crc32.h"
+#include "crc32-tables.h"
 
-#include <limits.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_HAVE_PCLMUL 1
+#endif
 
-/* Very dumb CRC-32 implementation */
-uint32_t crc32(const void *buf, size_t len)
+typedef uint32_t (*crc32_fold_fn)(uint32_t rem, const uint8_t *buf, size_t len);
+
+/* Table driven kernel, works on the inverted remainder */
+static uint32_t crc32_generic(uint32_t rem, const uint8_t *buf, size_t len)
 {
-    const uint8_t *buf8 = buf;
-    uint32_t       rem  = 0xffffffff;
+#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_NIBBLE )
+    const uint32_t *t = crc32_table_nibble;
 
     for ( ; len; len-- )
     {
-        int i;
+        rem ^= *buf++;
+        rem = t[rem & 0x0f] ^ (rem >> 4);
+        rem = t[rem & 0x0f] ^ (rem >> 4);
+    }
+#else
+    const uint32_t(*t)[256] = crc32_table;
+
+#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_SLICE )
+    /* Align to a 32-bit boundary */
+    for ( ; len && ((uintptr_t) buf & 3); len-- ) rem = t[0][(rem ^ *buf++) & 0xff] ^ (rem >> 8);
+
+    for ( ; len >= 8; len -= 8, buf += 8 )
+    {
+        uint32_t one, two;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        one = *(const uint32_t *) buf ^ rem;
+        two = *(const uint32_t *) (buf + 4);
+#else
+        one = ((uint32_t) buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24)) ^ rem;
+        two = (uint32_t) buf[4] | ((uint32_t) buf[5] << 8) | ((uint32_t) buf[6] << 16) | ((uint32_t) buf[7] << 24);
+#endif
+
+        rem = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+              t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+    }
+#endif
+
+    for ( ; len; len-- ) rem = t[0][(rem ^ *buf++) & 0xff] ^ (rem >> 8);
+#endif
+
+    return rem;
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+
+/* Carry-less multiplication folding, see Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction". The constants are the
+ * bit-reflected x^n mod P values given at the end of the paper. Requires at
+ * least 64 bytes and a multiple of 16 bytes, works on the inverted remainder. */
+__attribute__((target("pclmul,sse4.1"))) static uint32_t crc32_pclmul(uint32_t rem, const uint8_t *buf, size_t len)
+{
+    static const uint64_t k1k2[] __attribute__((aligned(16))) = {0x0154442bd4, 0x01c6e41596};
+    static const uint64_t k3k4[] __attribute__((aligned(16))) = {0x01751997d0, 0x00ccaa009e};
+    static const uint64_t k5k0[] __attribute__((aligned(16))) = {0x0163cd6124, 0x0000000000};
+    static const uint64_t poly[] __attribute__((aligned(16))) = {0x01db710641, 0x01f7011641};
+
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *) (buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *) (buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *) (buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *) (buf + 0x30));
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(rem));
+    x0 = _mm_load_si128((const __m128i *) k1k2);
+
+    buf += 64;
+    len -= 64;
+
+    /* Parallel fold blocks of 64 */
+    while ( len >= 64 )
+    {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+        y5 = _mm_loadu_si128((const __m128i *) (buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *) (buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *) (buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *) (buf + 0x30));
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+        buf += 64;
+        len -= 64;
+    }
+
+    /* Fold into 128 bits */
+    x0 = _mm_load_si128((const __m128i *) k3k4);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* Single fold blocks of 16 */
+    while ( len >= 16 )
+    {
+        x2 = _mm_loadu_si128((const __m128i *) buf);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+
+    x0 = _mm_loadl_epi64((const __m128i *) k5k0);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x0 = _mm_load_si128((const __m128i *) poly);
+
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t) _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_fold_pclmul(uint32_t rem, const uint8_t *buf, size_t len)
+{
+    if ( len >= 64 )
+    {
+        size_t bulk = len & ~(size_t) 15;
+
+        rem = crc32_pclmul(rem, buf, bulk);
+        buf += bulk;
+        len -= bulk;
+    }
+
+    return crc32_generic(rem, buf, len);
+}
+
+#endif
+
+/* Multiply a and b modulo P, both reflected polynomials */
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t) 1 << 31, prod = 0;
+
+    for ( ;; )
+    {
+        if ( a & m )
+        {
+            prod ^= b;
+            if ( (a & (m - 1)) == 0 )
+                break;
+        }
+        m >>= 1;
+        b = (b >> 1) ^ ((b & 1) * CRC32_POLY);
+    }
 
-        rem = rem ^ *buf8;
-        for ( i = 0; i < CHAR_BIT; i++ ) rem = (rem >> 1) ^ ((rem & 1) * 0xEDB88320);
+    return prod;
+}
 
-        buf8++;
+/* x^(n * 2^k) mod P, in O(log n) multiplications */
+static uint32_t crc32_x2nmodp(size_t n, unsigned k)
+{
+    uint32_t prod = (uint32_t) 1 << 31; /* x^0 */
+
+    for ( ; n; n >>= 1, k++ )
+    {
+        if ( n & 1 )
+            prod = crc32_multmodp(crc32_x2n_table[k & 31], prod);
     }
 
-    return rem ^ 0xffffffff;
+    return prod;
+}
+
+/* Select the kernel for this CPU, once */
+static crc32_fold_fn crc32_kernel(void)
+{
+#ifdef CRC32_HAVE_PCLMUL
+    static crc32_fold_fn fold;
+    crc32_fold_fn        sel = __atomic_load_n(&fold, __ATOMIC_RELAXED);
+
+    /* Concurrent first calls select the same kernel */
+    if ( ! sel )
+    {
+        sel = crc32_generic;
+
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1") )
+            sel = crc32_fold_pclmul;
+
+        __atomic_store_n(&fold, sel, __ATOMIC_RELAXED);
+    }
+
+    return sel;
+#else
+    return crc32_generic;
+#endif
+}
+
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len)
+{
+    return crc32_kernel()(crc ^ 0xffffffff, buf, len) ^ 0xffffffff;
+}
+
+uint32_t crc32(const void *buf, size_t len)
+{
+    return crc32_update(0, buf, len);
+}
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+    /* Shift crc1 over len2 bytes (8 * len2 bits) of zeros, then add crc2 */
+    return crc32_multmodp(crc32_x2nmodp(len2, 3), crc1) ^ crc2;
 }
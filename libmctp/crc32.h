@@ -6,4 +6,13 @@
 
 uint32_t crc32(const void *buf, size_t len);
 
+/* Continue a CRC-32 over more data: crc32(a + b) ==
+ * crc32_update(crc32(a), b). Start with a 'crc' of zero. */
+uint32_t crc32_update(uint32_t crc, const void *buf, size_t len);
+
+/* Combine the CRCs of two consecutive blocks: crc32(a + b) ==
+ * crc32_combine(crc32(a), crc32(b), len(b)). Runs in O(log len2), so
+ * blocks can be checksummed independently and merged afterwards. */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
 #endif
@@ -0,0 +1,167 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+#include <string.h>
+
+#include "crc32c.h"
+#include "crc32c-tables.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32C_HAVE_SSE42 1
+#endif
+
+typedef uint32_t (*crc32c_fold_fn)(uint32_t rem, const uint8_t *buf, size_t len);
+
+/* Table driven kernel, works on the inverted remainder */
+static uint32_t crc32c_generic(uint32_t rem, const uint8_t *buf, size_t len)
+{
+#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_NIBBLE )
+    const uint32_t *t = crc32c_table_nibble;
+
+    for ( ; len; len-- )
+    {
+        rem ^= *buf++;
+        rem = t[rem & 0x0f] ^ (rem >> 4);
+        rem = t[rem & 0x0f] ^ (rem >> 4);
+    }
+#else
+    const uint32_t(*t)[256] = crc32c_table;
+
+#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_SLICE )
+    /* Align to a 32-bit boundary */
+    for ( ; len && ((uintptr_t) buf & 3); len-- ) rem = t[0][(rem ^ *buf++) & 0xff] ^ (rem >> 8);
+
+    for ( ; len >= 8; len -= 8, buf += 8 )
+    {
+        uint32_t one, two;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        one = *(const uint32_t *) buf ^ rem;
+        two = *(const uint32_t *) (buf + 4);
+#else
+        one = ((uint32_t) buf[0] | ((uint32_t) buf[1] << 8) | ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24)) ^ rem;
+        two = (uint32_t) buf[4] | ((uint32_t) buf[5] << 8) | ((uint32_t) buf[6] << 16) | ((uint32_t) buf[7] << 24);
+#endif
+
+        rem = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^ t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+              t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+    }
+#endif
+
+    for ( ; len; len-- ) rem = t[0][(rem ^ *buf++) & 0xff] ^ (rem >> 8);
+#endif
+
+    return rem;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+
+/* The SSE4.2 crc32 instruction implements CRC-32C directly, on the same
+ * inverted and reflected remainder as the tables */
+__attribute__((target("sse4.2"))) static uint32_t crc32c_sse42(uint32_t rem, const uint8_t *buf, size_t len)
+{
+    for ( ; len && ((uintptr_t) buf & 7); len-- ) rem = _mm_crc32_u8(rem, *buf++);
+
+#ifdef __x86_64__
+    {
+        uint64_t rem64 = rem, word;
+
+        for ( ; len >= 8; len -= 8, buf += 8 )
+        {
+            memcpy(&word, buf, sizeof(word));
+            rem64 = _mm_crc32_u64(rem64, word);
+        }
+
+        rem = (uint32_t) rem64;
+    }
+#endif
+
+    for ( ; len >= 4; len -= 4, buf += 4 )
+    {
+        uint32_t word;
+
+        memcpy(&word, buf, sizeof(word));
+        rem = _mm_crc32_u32(rem, word);
+    }
+
+    for ( ; len; len-- ) rem = _mm_crc32_u8(rem, *buf++);
+
+    return rem;
+}
+
+#endif
+
+/* Multiply a and b modulo P, both reflected polynomials */
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = (uint32_t) 1 << 31, prod = 0;
+
+    for ( ;; )
+    {
+        if ( a & m )
+        {
+            prod ^= b;
+            if ( (a & (m - 1)) == 0 )
+                break;
+        }
+        m >>= 1;
+        b = (b >> 1) ^ ((b & 1) * CRC32C_POLY);
+    }
+
+    return prod;
+}
+
+/* x^(n * 2^k) mod P, in O(log n) multiplications */
+static uint32_t crc32c_x2nmodp(size_t n, unsigned k)
+{
+    uint32_t prod = (uint32_t) 1 << 31; /* x^0 */
+
+    for ( ; n; n >>= 1, k++ )
+    {
+        if ( n & 1 )
+            prod = crc32c_multmodp(crc32c_x2n_table[k & 31], prod);
+    }
+
+    return prod;
+}
+
+/* Select the kernel for this CPU, once */
+static crc32c_fold_fn crc32c_kernel(void)
+{
+#ifdef CRC32C_HAVE_SSE42
+    static crc32c_fold_fn fold;
+    crc32c_fold_fn        sel = __atomic_load_n(&fold, __ATOMIC_RELAXED);
+
+    /* Concurrent first calls select the same kernel */
+    if ( ! sel )
+    {
+        sel = crc32c_generic;
+
+        __builtin_cpu_init();
+        if ( __builtin_cpu_supports("sse4.2") )
+            sel = crc32c_sse42;
+
+        __atomic_store_n(&fold, sel, __ATOMIC_RELAXED);
+    }
+
+    return sel;
+#else
+    return crc32c_generic;
+#endif
+}
+
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len)
+{
+    return crc32c_kernel()(crc ^ 0xffffffff, buf, len) ^ 0xffffffff;
+}
+
+uint32_t crc32c(const void *buf, size_t len)
+{
+    return crc32c_update(0, buf, len);
+}
+
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+    /* Shift crc1 over len2 bytes (8 * len2 bits) of zeros, then add crc2 */
+    return crc32c_multmodp(crc32c_x2nmodp(len2, 3), crc1) ^ crc2;
+}
@@ -0,0 +1,19 @@
+#ifndef _CRC32C_H
+#define _CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32C (Castagnoli), as used for the MCTP message integrity check */
+uint32_t crc32c(const void *buf, size_t len);
+
+/* Continue a CRC-32C over more data: crc32c(a + b) ==
+ * crc32c_update(crc32c(a), b). Start with a 'crc' of zero. */
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len);
+
+/* Combine the CRCs of two consecutive blocks: crc32c(a + b) ==
+ * crc32c_combine(crc32c(a), crc32c(b), len(b)). Runs in O(log len2), so
+ * blocks can be checksummed independently and merged afterwards. */
+uint32_t crc32c_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+#endif
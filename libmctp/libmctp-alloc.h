@@ -3,14 +3,13 @@
 #ifndef _LIBMCTP_ALLOC_H
 #define _LIBMCTP_ALLOC_H
 
+#include <stdint.h>
 #include <stdlib.h>
 
 void *__mctp_alloc(size_t size);
 void  __mctp_free(void *ptr);
 
-void *__mctp_alloc_context(size_t size);
-void  __mctp_free_context(void *ptr);
-
-int __mctp_mem_init(void);
+/* Pools on the hal message queues, see struct mctp_alloc_ops */
+extern const struct mctp_alloc_ops mctp_default_alloc_ops;
 
 #endif /* _LIBMCTP_ALLOC_H */
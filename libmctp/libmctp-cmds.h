@@ -69,6 +69,36 @@ struct mctp_ctrl_msg_hdr
 #define MCTP_CTRL_CC_ERROR_UNSUPPORTED_CMD 0x05
 /* 0x80 - 0xFF are command specific */
 
+/* Requests carry no completion code, their data starts at its place */
+#define MCTP_CTRL_REQ_HDR_SIZE 3
+
+/* Get MCTP Version Support: message type standing for the base specification */
+#define MCTP_CTRL_VERSION_TYPE_BASE 0xFF
+
+/*
+ * Built-in responder.
+ *
+ * Once enabled, the core answers Get Endpoint ID, Get Endpoint UUID (when a
+ * UUID is given), Get MCTP Version Support for the base specification and
+ * the control protocol, and Get Message Type Support straight from the RX
+ * path. The responses are built here, a request only patches its instance
+ * ID and the EID of the bus into one before it is queued, so discovery
+ * never reaches the application. Other commands, and versions of the other
+ * message types, still go to the transport or message RX callbacks.
+ */
+#define MCTP_CTRL_MSG_TYPES_MAX 16
+
+struct mctp_ctrl_info
+{
+    const uint8_t *msg_types; /* Supported types besides control, which is always listed */
+    size_t         n_msg_types;
+    const uint8_t *uuid; /* 16 bytes, NULL leaves Get Endpoint UUID to the application */
+};
+
+/* 'info' NULL disables the responder, -EINVAL for more than
+ * MCTP_CTRL_MSG_TYPES_MAX message types */
+int mctp_set_ctrl_responder(struct mctp *mctp, const struct mctp_ctrl_info *info);
+
 #ifdef __cplusplus
 }
 #endif
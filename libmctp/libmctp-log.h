@@ -3,24 +3,76 @@
 #ifndef _LIBMCTP_LOG_H
 #define _LIBMCTP_LOG_H
 
+#include <stdint.h>
+
 /* libmctp-internal logging */
 
 void mctp_prlog(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void mctp_prlog_bin(int level, const char *fmt, int nargs, const uintptr_t *args);
+
+/* Most verbose level of the configured sink, -1 while logging is off */
+extern int mctp_log_threshold;
 
 #ifndef pr_fmt
 #define pr_fmt(x) x
 #endif
 
+/*
+ * Levels above MCTP_LOG_LEVEL are compiled out, call and arguments alike.
+ * Everything is in by default in DEBUG builds and nothing otherwise; e.g.
+ * -DMCTP_LOG_LEVEL=MCTP_LOG_INFO keeps the per byte serial traces out of a
+ * debug image. What is left costs a compare when the sink filters it.
+ */
+#ifndef MCTP_LOG_LEVEL
 #ifdef DEBUG
-#define mctp_prerr(fmt, ...)   mctp_prlog(MCTP_LOG_ERR, pr_fmt(fmt), ##__VA_ARGS__)
-#define mctp_prwarn(fmt, ...)  mctp_prlog(MCTP_LOG_WARNING, pr_fmt(fmt), ##__VA_ARGS__)
-#define mctp_prinfo(fmt, ...)  mctp_prlog(MCTP_LOG_INFO, pr_fmt(fmt), ##__VA_ARGS__)
-#define mctp_prdebug(fmt, ...) mctp_prlog(MCTP_LOG_DEBUG, pr_fmt(fmt), ##__VA_ARGS__)
+#define MCTP_LOG_LEVEL MCTP_LOG_DEBUG
 #else
-#define mctp_prerr(fmt, ...)
-#define mctp_prwarn(fmt, ...)
-#define mctp_prinfo(fmt, ...)
-#define mctp_prdebug(fmt, ...)
+#define MCTP_LOG_LEVEL (-1)
+#endif
+#endif
+
+#define mctp_log_enabled(level) ((level) <= MCTP_LOG_LEVEL && (level) <= mctp_log_threshold)
 
+#ifdef MCTP_LOG_BINARY
+/*
+ * Binary log: record the format string address and the arguments, as
+ * uintptr_t, in the ring set by mctp_set_log_binary(). Nothing is
+ * formatted on the target, resources/mctp_log_decode.py prints the ring
+ * against the ELF. Up to MCTP_LOG_BIN_ARGS arguments.
+ */
+#define _MCTP_LOG_N(_0, _1, _2, _3, _4, _5, _6, N, ...) N
+#define _MCTP_LOG_NARGS(...)                            _MCTP_LOG_N(_0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define _MCTP_LOG_CAT(a, b)                             a##b
+#define _MCTP_LOG_MAP(n)                                _MCTP_LOG_CAT(_MCTP_LOG_MAP, n)
+
+#define _MCTP_LOG_MAP0()
+#define _MCTP_LOG_MAP1(a)                , (uintptr_t) (a)
+#define _MCTP_LOG_MAP2(a, b)             _MCTP_LOG_MAP1(a) _MCTP_LOG_MAP1(b)
+#define _MCTP_LOG_MAP3(a, b, c)          _MCTP_LOG_MAP2(a, b) _MCTP_LOG_MAP1(c)
+#define _MCTP_LOG_MAP4(a, b, c, d)       _MCTP_LOG_MAP3(a, b, c) _MCTP_LOG_MAP1(d)
+#define _MCTP_LOG_MAP5(a, b, c, d, e)    _MCTP_LOG_MAP4(a, b, c, d) _MCTP_LOG_MAP1(e)
+#define _MCTP_LOG_MAP6(a, b, c, d, e, f) _MCTP_LOG_MAP5(a, b, c, d, e) _MCTP_LOG_MAP1(f)
+
+/* The leading 0 keeps the array non-empty when there are no arguments */
+#define mctp_prlog_at(level, fmt, ...)                                                                   \
+    do                                                                                                   \
+    {                                                                                                    \
+        if ( mctp_log_enabled(level) )                                                                   \
+            mctp_prlog_bin(level, fmt, _MCTP_LOG_NARGS(__VA_ARGS__),                                     \
+                           (const uintptr_t[]){0 _MCTP_LOG_MAP(_MCTP_LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)} + 1); \
+    } while ( 0 )
+#else
+#define mctp_prlog_at(level, fmt, ...)                  \
+    do                                                  \
+    {                                                   \
+        if ( mctp_log_enabled(level) )                  \
+            mctp_prlog(level, fmt, ##__VA_ARGS__);      \
+    } while ( 0 )
 #endif
+
+#define mctp_prerr(fmt, ...)   mctp_prlog_at(MCTP_LOG_ERR, pr_fmt(fmt), ##__VA_ARGS__)
+#define mctp_prwarn(fmt, ...)  mctp_prlog_at(MCTP_LOG_WARNING, pr_fmt(fmt), ##__VA_ARGS__)
+#define mctp_prinfo(fmt, ...)  mctp_prlog_at(MCTP_LOG_INFO, pr_fmt(fmt), ##__VA_ARGS__)
+#define mctp_prdebug(fmt, ...) mctp_prlog_at(MCTP_LOG_DEBUG, pr_fmt(fmt), ##__VA_ARGS__)
+
 #endif /* _LIBMCTP_LOG_H */
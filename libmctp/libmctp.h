@@ -44,21 +44,105 @@ struct mctp_hdr
 #define MCTP_MESSAGE_CAPTURE_OUTGOING true
 #define MCTP_MESSAGE_CAPTURE_INCOMING false
 
-/* Baseline Transmission Unit and packet size */
-#define MCTP_BTU               256
+/* Message integrity check: messages with the IC bit set in their type byte
+ * carry a CRC-32C trailer. For the types enabled with mctp_set_msg_ic() the
+ * core appends it on TX and verifies and strips it on RX */
+#define MCTP_MSG_IC_BIT  (1 << 7)
+#define MCTP_MSG_IC_SIZE 4
+
+#ifndef MCTP_MESSAGE_IC
+#define MCTP_MESSAGE_IC 1
+#endif
+
+/* Concurrent message reassembly contexts, a power of two up to 64. The
+ * lookup hash has twice as many slots */
+#ifndef MCTP_MSG_CTX_COUNT
+#define MCTP_MSG_CTX_COUNT 8
+#endif
+#define MCTP_MSG_CTX_HASH_SIZE (2 * MCTP_MSG_CTX_COUNT)
+
+/* Reassembly timeout in milliseconds, counted from the first packet of a
+ * message. DSP0236 allows assembly timeouts in the seconds. Expiry is
+ * tracked by a timer wheel of MCTP_MSG_CTX_WHEEL_SLOTS slots (a power of
+ * two), advanced by mctp_poll() */
+#ifndef MCTP_MSG_CTX_TIMEOUT
+#define MCTP_MSG_CTX_TIMEOUT 5000
+#endif
+#ifndef MCTP_MSG_CTX_WHEEL_SLOTS
+#define MCTP_MSG_CTX_WHEEL_SLOTS 16
+#endif
+#define MCTP_MSG_CTX_WHEEL_TICK (MCTP_MSG_CTX_TIMEOUT / MCTP_MSG_CTX_WHEEL_SLOTS)
+
+/* Outstanding requests of an instance, across all EIDs (at most 32), and
+ * how long a request waits for its response, in milliseconds. Expiry is
+ * checked by mctp_poll(), with the resolution of a wheel tick */
+#ifndef MCTP_REQ_COUNT
+#define MCTP_REQ_COUNT 16
+#endif
+#ifndef MCTP_REQ_TIMEOUT
+#define MCTP_REQ_TIMEOUT 1000
+#endif
+
+/* Message types that can be streamed, see mctp_set_rx_stream() */
+#ifndef MCTP_RX_STREAM_COUNT
+#define MCTP_RX_STREAM_COUNT 4
+#endif
+
+/* Default count of packets in the pool of a binding */
+#ifndef MCTP_PKTBUF_POOL_COUNT
+#define MCTP_PKTBUF_POOL_COUNT 16
+#endif
+
+/* Reassembly buffer of a context, one per context in the context pool */
+#ifndef MCTP_MSG_CTX_BUF_SIZE
+#define MCTP_MSG_CTX_BUF_SIZE 1600
+#endif
+
+/* Busses a stack instance can register */
+#ifndef MCTP_MAX_BUSSES
+#define MCTP_MAX_BUSSES 4
+#endif
+
+/* Baseline Transmission Unit and packet size. DSP0236 sets the baseline at
+ * 64 bytes, the payload of a USB fragment */
+#ifndef MCTP_BTU
+#define MCTP_BTU 64
+#endif
 #define MCTP_PACKET_SIZE(unit) ((unit) + sizeof(struct mctp_hdr))
 #define MCTP_BODY_SIZE(unit)   ((unit) - sizeof(struct mctp_hdr))
 
 /* packet buffers */
 
+/* Called once the memory of a message sent through mctp_message_txv() is
+ * no longer referenced */
+typedef void (*mctp_tx_done_fn)(void *arg);
+
 struct mctp_pktbuf
 {
     size_t              start, end, size;
     size_t              mctp_hdr_off;
     struct mctp_pktbuf *next;
+    const void         *ext_data; /* Payload left in the sender's memory, follows data[end] */
+    size_t              ext_len;
+    mctp_tx_done_fn     done; /* Called when the packet is freed */
+    void               *done_arg;
+    struct mctp        *mctp; /* Instance whose allocator the packet returns to, NULL for __mctp_free() */
+    uintptr_t           pool; /* Pool of the binding, in that allocator */
     unsigned char       data[];
 };
 
+/* A span of a message to transmit */
+struct mctp_iov
+{
+    const void *base;
+    size_t      len;
+};
+
+/* Smallest payload span worth referencing rather than copying */
+#ifndef MCTP_TX_GATHER_MIN
+#define MCTP_TX_GATHER_MIN 32
+#endif
+
 struct mctp_binding;
 
 struct mctp_pktbuf *mctp_pktbuf_alloc(struct mctp_binding *hw, size_t len);
@@ -71,7 +155,16 @@ void               *mctp_pktbuf_alloc_end(struct mctp_pktbuf *pkt, size_t size);
 int                 mctp_pktbuf_push(struct mctp_pktbuf *pkt, void *data, size_t len);
 void               *mctp_pktbuf_pop(struct mctp_pktbuf *pkt, size_t len);
 
-/* MCTP core */
+/* MCTP core
+ *
+ * A struct mctp holds all the state of a stack: busses, reassembly contexts,
+ * routes, clock and allocator pools. Independent instances can run in
+ * parallel threads, one per USB function for instance, as long as each is
+ * confined to a single thread: all calls on an instance, its bindings and
+ * its packets come from that thread. mctp_init(), bus registration and the
+ * log setup draw from the shared hal heap and log configuration, so they
+ * are done before the threads start or under a lock of the caller.
+ */
 struct mctp;
 struct mctp_bus;
 
@@ -79,41 +172,268 @@ struct mctp *mctp_init(void);
 void         mctp_set_max_message_size(struct mctp *mctp, size_t message_size);
 typedef void (*mctp_capture_fn)(struct mctp_pktbuf *pkt, bool outgoing, void *user);
 void mctp_set_capture_handler(struct mctp *mctp, mctp_capture_fn fn, void *user);
+
+/* Capture ring.
+ *
+ * For captures at line rate: rather than calling out per packet, the core
+ * copies the first MCTP_CAPTURE_SNAPLEN bytes of each packet, its MCTP
+ * header on, into the next record of a ring preallocated by the caller,
+ * stamped by 'clock' (a cycle counter, for instance). A drainer, which may
+ * run in another thread, takes the records in batches: peek returns the
+ * run of records ready from 'first', consume hands them back. The ring has
+ * a single producer, the instance, and a single consumer, and takes no
+ * lock; packets arriving while it is full are counted in 'dropped'.
+ */
+#ifndef MCTP_CAPTURE_SNAPLEN
+#define MCTP_CAPTURE_SNAPLEN 32
+#endif
+
+struct mctp_capture_rec
+{
+    uint64_t ts;       /* 'clock' at capture */
+    uint16_t len;      /* Packet size, MCTP header included */
+    uint8_t  caplen;   /* Bytes in 'data' */
+    uint8_t  outgoing; /* MCTP_MESSAGE_CAPTURE_OUTGOING or _INCOMING */
+    uint8_t  data[MCTP_CAPTURE_SNAPLEN];
+};
+
+typedef uint64_t (*mctp_capture_clock_fn)(void);
+
+struct mctp_capture_ring
+{
+    struct mctp_capture_rec *recs;
+    uint32_t                 count;   /* Records in 'recs', a power of two */
+    uint32_t                 head;    /* Records written, by the core */
+    uint32_t                 tail;    /* Records consumed, by the drainer */
+    uint32_t                 dropped; /* Packets missed as the ring was full */
+    mctp_capture_clock_fn    clock;
+};
+
+int    mctp_capture_ring_init(struct mctp_capture_ring *ring, struct mctp_capture_rec *recs, uint32_t count, mctp_capture_clock_fn clock);
+void   mctp_set_capture_ring(struct mctp *mctp, struct mctp_capture_ring *ring);
+size_t mctp_capture_ring_peek(struct mctp_capture_ring *ring, const struct mctp_capture_rec **first);
+void   mctp_capture_ring_consume(struct mctp_capture_ring *ring, size_t n);
 void mctp_destroy(struct mctp *mctp);
 
+/* Clock and timeouts.
+ *
+ * 'now' returns a monotonic time in milliseconds. Without it, reassembly
+ * and requests never time out. mctp_poll() reclaims the reassembly contexts older than
+ * MCTP_MSG_CTX_TIMEOUT, completes the requests older than MCTP_REQ_TIMEOUT
+ * and returns how many it expired in all; it should be called at
+ * least every MCTP_MSG_CTX_WHEEL_TICK ms, as deadlines are taken from the
+ * time of the last poll so that receiving costs no clock read.
+ */
+typedef uint64_t (*mctp_now_fn)(void *data);
+
+void mctp_set_now_op(struct mctp *mctp, mctp_now_fn now, void *data);
+int  mctp_poll(struct mctp *mctp);
+
+/* Counters, since mctp_init() */
+struct mctp_stats
+{
+    uint32_t rx_ctx_timeouts;  /* Messages dropped on reassembly timeout */
+    uint32_t rx_ctx_exhausted; /* Messages dropped for lack of a reassembly context */
+    uint32_t req_timeouts;     /* Requests left without a response */
+    uint32_t ctrl_responses;   /* Control requests answered by the core */
+    uint32_t bridge_cut;       /* Packets bridged cut-through */
+};
+
+void mctp_get_stats(struct mctp *mctp, struct mctp_stats *stats);
+
+/* Allocator of an instance.
+ *
+ * Memory comes from pools of fixed size items, created when a bus is
+ * registered: one per binding for its packets and one of MCTP_MSG_CTX_COUNT
+ * buffers of MCTP_MSG_CTX_BUF_SIZE bytes for message reassembly. A pool is
+ * an opaque handle, 0 standing for a failure. The default allocator builds
+ * the pools on the hal message queues.
+ *
+ * @pool_create: Creates a pool of 'count' items of 'item_size' bytes.
+ * @pkt_alloc: Takes a packet from the pool of a binding.
+ * @ctx_alloc: Takes a reassembly buffer from the context pool.
+ * @free: Returns 'ptr' to 'pool'.
+ */
+struct mctp_alloc_ops
+{
+    uintptr_t (*pool_create)(void *data, size_t item_size, size_t count);
+    void     *(*pkt_alloc)(void *data, uintptr_t pool);
+    void     *(*ctx_alloc)(void *data, uintptr_t pool);
+    void      (*free)(void *data, uintptr_t pool, void *ptr);
+};
+
+/* Replaces the default allocator, -EBUSY once a bus is registered */
+int mctp_set_alloc_ops(struct mctp *mctp, const struct mctp_alloc_ops *ops, void *data);
+
 /* Register a binding to the MCTP core, and creates a bus (populating
  * binding->bus).
  *
  * If this function is called, the MCTP stack is initialised as an 'endpoint',
  * and will deliver local packets to a RX callback - see `mctp_set_rx_all()`
- * below.
+ * below. Up to MCTP_MAX_BUSSES busses can be registered, each with its own
+ * EID; -ENOSPC is returned past that.
  */
 int mctp_register_bus(struct mctp *mctp, struct mctp_binding *binding, mctp_eid_t eid);
 
 void mctp_unregister_bus(struct mctp *mctp, struct mctp_binding *binding);
 
+/* Routing table.
+ *
+ * Messages to the EIDs in [first, last] are sent on the bus of 'binding',
+ * a range typically standing for the EID pool behind a bridge. EIDs without
+ * a route use the first registered bus. Removing a route restores that
+ * default, as does unregistering the bus it went through.
+ */
+int                  mctp_route_add(struct mctp *mctp, mctp_eid_t first, mctp_eid_t last, struct mctp_binding *binding);
+int                  mctp_route_del(struct mctp *mctp, mctp_eid_t first, mctp_eid_t last);
+struct mctp_binding *mctp_route_lookup(struct mctp *mctp, mctp_eid_t eid);
+
 /* Create a simple bidirectional bridge between busses.
  *
  * In this mode, the MCTP stack is initialised as a bridge. There is no EID
  * defined, so no packets are considered local. Instead, all messages from one
  * binding are forwarded to the other.
+ *
+ * When the MTU and framing of the incoming binding fit the outgoing one, its
+ * packets are forwarded cut-through: each is moved to the outgoing queue as
+ * it arrives, in its own buffer, which returns to the pool of the incoming
+ * binding once sent. Otherwise messages are reassembled and packetized again
+ * for the outgoing binding. mctp_set_bridge_cut_through() turns the former
+ * off, so that every message is stored and forwarded.
  */
-int mctp_bridge_busses(struct mctp *mctp, struct mctp_binding *b1, struct mctp_binding *b2);
+int  mctp_bridge_busses(struct mctp *mctp, struct mctp_binding *b1, struct mctp_binding *b2);
+void mctp_set_bridge_cut_through(struct mctp *mctp, bool enable);
 
 typedef void (*mctp_rx_fn)(uint8_t src_eid, bool tag_owner, uint8_t msg_tag, void *data, void *msg, size_t len);
 
 int mctp_set_rx_all(struct mctp *mctp, mctp_rx_fn fn, void *data);
 
+/* Zero-copy delivery: fragments are kept as received and the message is
+ * handed over as the ordered list of its packets (linked through 'next'),
+ * 'len' being the total payload. The packets return to the pool once the
+ * callback returns, so they must not be kept. The packet pool must be
+ * sized for the fragments of all the messages in flight.
+ *
+ * Once set, every message for a local EID goes through this callback
+ * except MCTP control messages, which are still reassembled in a buffer
+ * and delivered through `mctp_set_rx_all()`.
+ */
+typedef void (*mctp_rx_pkts_fn)(uint8_t src_eid, bool tag_owner, uint8_t msg_tag, void *data, struct mctp_pktbuf *pkts, size_t len);
+
+int mctp_set_rx_pkts(struct mctp *mctp, mctp_rx_pkts_fn fn, void *data);
+
+/* Application provided reassembly buffers.
+ *
+ * 'get' is called at the start of every multi-packet message that is not
+ * delivered scattered or streamed, with the sender and tag. Returning 0 with
+ * 'rx_buf' filled has the message reassembled straight into 'buf' + 'offset',
+ * for up to 'size' bytes, and handed to the RX callback from there.
+ * Otherwise a context buffer of the core is used.
+ *
+ * Like scattered and streamed delivery, this only applies to endpoints: a
+ * bridge reassembles the messages it forwards in its own context buffers.
+ *
+ * 'put' is called with 'buf' once the core is done with it: after the RX
+ * callback returned, or when the message was dropped.
+ */
+struct mctp_rx_buf
+{
+    void  *buf;    /* Destination buffer */
+    size_t offset; /* Where the message starts in 'buf', to align what follows */
+    size_t size;   /* Bytes available past 'offset' */
+};
+
+typedef int (*mctp_rx_buf_get_fn)(uint8_t src_eid, uint8_t msg_tag, void *data, struct mctp_rx_buf *rx_buf);
+typedef void (*mctp_rx_buf_put_fn)(void *data, void *buf);
+
+int mctp_set_rx_buf_ops(struct mctp *mctp, mctp_rx_buf_get_fn get, mctp_rx_buf_put_fn put, void *data);
+
+/* Streaming delivery, for messages too large to be reassembled: messages of
+ * 'msg_type' are handed over in order, one chunk per packet as it arrives,
+ * and their context only keeps the sequence state. 'chunk' is only valid
+ * during the callback. The first chunk is flagged MCTP_RX_STREAM_SOM and the
+ * last one MCTP_RX_STREAM_EOM, the integrity check trailer if any being
+ * verified and left out. A message dropped on the way, out of sequence,
+ * timed out or failing its integrity check, ends with a MCTP_RX_STREAM_ABORT
+ * call with no data instead.
+ *
+ * Streamed types take precedence over the other RX callbacks; control
+ * messages and responses to our requests are never streamed. A NULL 'fn'
+ * stops streaming 'msg_type', abandoning the messages in progress. Returns
+ * -ENOSPC once MCTP_RX_STREAM_COUNT types are streamed.
+ */
+#define MCTP_RX_STREAM_SOM   (1 << 0)
+#define MCTP_RX_STREAM_EOM   (1 << 1)
+#define MCTP_RX_STREAM_ABORT (1 << 2)
+
+typedef void (*mctp_rx_stream_fn)(uint8_t src_eid, bool tag_owner, uint8_t msg_tag, void *data, unsigned int flags, const void *chunk,
+                                  size_t len);
+
+int mctp_set_rx_stream(struct mctp *mctp, uint8_t msg_type, mctp_rx_stream_fn fn, void *data);
+
+/* Integrity check handling, off for all types by default since the trailer
+ * format belongs to each message type. Once enabled for 'msg_type', given
+ * without the IC bit, the core appends the CRC-32C trailer to the messages
+ * sent with the IC bit set, and verifies and strips it from the ones
+ * received, dropping those failing the check. */
+int mctp_set_msg_ic(struct mctp *mctp, uint8_t msg_type, bool enable);
+
+/* Tags taken by outstanding requests, see mctp_message_request(), are
+ * refused with -EBUSY when sending as the tag owner */
 int mctp_message_tx(struct mctp *mctp, mctp_eid_t eid, bool tag_owner, uint8_t msg_tag, void *msg, size_t msg_len);
 
+/* Requests.
+ *
+ * mctp_message_request() sends 'msg' to 'eid' as the tag owner, with one of
+ * the 8 tags of that EID, and returns the tag. Up to 8 requests per EID, and
+ * MCTP_REQ_COUNT overall, can be outstanding; -EBUSY is returned past that.
+ * The response, the next message from 'eid' with that tag and TO clear, is
+ * handed to 'fn' instead of the RX callback, reassembled in a buffer, and
+ * frees the tag. A request still unanswered MCTP_REQ_TIMEOUT ms later is
+ * completed by mctp_poll() with a NULL 'msg'. 'fn' may issue new requests.
+ */
+typedef void (*mctp_resp_fn)(mctp_eid_t eid, uint8_t msg_tag, void *data, void *msg, size_t len);
+
+int mctp_message_request(struct mctp *mctp, mctp_eid_t eid, void *msg, size_t msg_len, mctp_resp_fn fn, void *data);
+
+/* Transmit a message gathered from 'iovcnt' spans.
+ *
+ * Without 'done' the spans are copied and may be reused on return. With
+ * 'done', on bindings that set 'tx_gather', packet payloads are referenced
+ * in place: the spans must stay untouched until 'done' is called, which
+ * happens exactly once when 0 is returned, possibly before the return.
+ */
+int mctp_message_txv(struct mctp *mctp, mctp_eid_t eid, bool tag_owner, uint8_t msg_tag, const struct mctp_iov *iov, size_t iovcnt, mctp_tx_done_fn done,
+                     void *done_arg);
+
 /* hardware bindings */
 
 /**
+ * @pkt_pool_count: Packets in the pool of the binding, 0 for
+ *      MCTP_PKTBUF_POOL_COUNT. The pool is created when the bus is registered,
+ *      each packet taking pkt_size bytes plus pkt_header bytes of headroom
+ *      and pkt_trailer bytes of tailroom, so media framing is added in place.
+ * @pkt_pool: Set by the core. A pool outlives the bus and is reused if the
+ *      binding registers again, with the same allocator.
+ * @pkt_pool_size: Set by the core, the packet bytes of the pool items. TX is
+ *      not enabled once pkt_size, with its headroom and tailroom, outgrows
+ *      them.
+ * @tx_gather: The binding sends pkt->ext_len bytes from pkt->ext_data after
+ *      the packet data (and before its trailer), letting the core leave the
+ *      payload of mctp_message_txv() in place. Otherwise ext_len is always 0.
  * @tx: Binding function to transmit one packet on the interface
  *      Return:
  *      * 0 - Success, pktbuf can be released
  *	* -EMSGSIZE - Packet exceeds binding MTU, pktbuf must be dropped
  *	* -EBUSY - Packet unable to be transmitted, pktbuf must be retained
+ * @tx_batch: Optional, used instead of @tx when set. Transmits packets from
+ *      the head of 'pkts', the 'n' queued packets linked through 'next', as
+ *      many as the interface takes in one transfer.
+ *      Return:
+ *      * >0 - Count of leading packets sent (or dropped as too large), the
+ *             core releases them. A count above 'n' is an error, the queue
+ *             is left as is and handed over again on the next flush
+ *	* -EBUSY - No packet transmitted, all must be retained
  */
 struct mctp_binding
 {
@@ -124,8 +444,13 @@ struct mctp_binding
     size_t           pkt_size;
     size_t           pkt_header;
     size_t           pkt_trailer;
+    size_t           pkt_pool_count;
+    uintptr_t        pkt_pool;
+    size_t           pkt_pool_size;
+    bool             tx_gather;
     int (*start)(struct mctp_binding *binding);
     int (*tx)(struct mctp_binding *binding, struct mctp_pktbuf *pkt);
+    int (*tx_batch)(struct mctp_binding *binding, struct mctp_pktbuf *pkts, size_t n);
     mctp_rx_fn control_rx;
     void      *control_rx_data;
 };
@@ -138,8 +463,12 @@ void mctp_binding_set_tx_enabled(struct mctp_binding *binding, bool enable);
  */
 void mctp_bus_rx(struct mctp_binding *binding, struct mctp_pktbuf *pkt);
 
-/* environment-specific allocation */
-void mctp_set_alloc_ops(void *(*alloc)(size_t), void (*free)(void *), void *(realloc) (void *, size_t));
+/*
+ * Receive the 'n' packets of 'pkts', linked through 'next', as carried by
+ * one transfer. Takes ownership of all of them. Packets continuing the
+ * message of the previous one skip the context lookup.
+ */
+void mctp_bus_rx_batch(struct mctp_binding *binding, struct mctp_pktbuf *pkts, size_t n);
 
 /* environment-specific logging */
 
@@ -147,6 +476,26 @@ void mctp_set_log_stdio(int level);
 void mctp_set_log_syslog(void);
 void mctp_set_log_custom(void (*fn)(int, const char *, va_list));
 
+/*
+ * Binary log, for builds with MCTP_LOG_BINARY: instead of formatting, the
+ * log macros store the format string address and the raw arguments in
+ * 'recs', overwriting the oldest record once full. Dump the records from
+ * the target and print them with resources/mctp_log_decode.py, which reads
+ * the strings from the ELF. 'count' must be a power of two.
+ */
+#define MCTP_LOG_BIN_ARGS 6
+
+struct mctp_log_rec
+{
+    const char *fmt;
+    uintptr_t   args[MCTP_LOG_BIN_ARGS];
+    uint32_t    seq; /* Order of the record from 1, 0 while it is written */
+    uint8_t     level;
+    uint8_t     nargs;
+};
+
+int mctp_set_log_binary(struct mctp_log_rec *recs, uint32_t count, int level);
+
 /* these should match the syslog-standard LOG_* definitions, for
  * easier use with syslog */
 #define MCTP_LOG_ERR     3
@@ -164,6 +513,9 @@ void mctp_set_log_custom(void (*fn)(int, const char *, va_list));
 /* Macro to calculate the size of the packet based on start and end offsets */
 #define MCTP_PKTBUF_SIZE(pkt) ((pkt)->end - (pkt)->start)
 
+/* Macro to calculate the size of the data following the MCTP header */
+#define MCTP_PKTBUF_PAYLOAD_SIZE(pkt) ((pkt)->end - (pkt)->mctp_hdr_off - sizeof(struct mctp_hdr))
+
 #ifdef __cplusplus
 }
 #endif
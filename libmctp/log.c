@@ -1,6 +1,8 @@
 /* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
 
+#include <errno.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "libmctp.h"
 #include "libmctp-log.h"
@@ -17,17 +19,25 @@
 #include <syslog.h>
 #endif
 
-enum
+/* Shared by all the instances: set before they start, then only read */
+static enum
 {
     MCTP_LOG_NONE,
     MCTP_LOG_STDIO,
     MCTP_LOG_SYSLOG,
     MCTP_LOG_CUSTOM,
+    MCTP_LOG_BINARY_RING,
 } log_type = MCTP_LOG_NONE;
 
+int mctp_log_threshold = -1;
+
 static int log_stdio_level;
 static void (*log_custom_fn)(int, const char *, va_list);
 
+static struct mctp_log_rec *log_bin_recs;
+static uint32_t             log_bin_mask;
+static uint32_t             log_bin_seq;
+
 void mctp_prlog(int level, const char *fmt, ...)
 {
     va_list ap;
@@ -55,24 +65,70 @@ void mctp_prlog(int level, const char *fmt, ...)
         case MCTP_LOG_CUSTOM:
             log_custom_fn(level, fmt, ap);
             break;
+        case MCTP_LOG_BINARY_RING:
+            /* Only the MCTP_LOG_BINARY macros record */
+            break;
     }
 
     va_end(ap);
 }
 
+/*
+ * Instances in other threads may log at the same time: each writer owns the
+ * slot it got from the sequence, and publishes the record by setting 'seq'
+ * once it is complete.
+ */
+void mctp_prlog_bin(int level, const char *fmt, int nargs, const uintptr_t *args)
+{
+    struct mctp_log_rec *rec;
+    uint32_t             seq;
+
+    if ( log_type != MCTP_LOG_BINARY_RING )
+        return;
+
+    seq = __atomic_fetch_add(&log_bin_seq, 1, __ATOMIC_RELAXED) + 1;
+    rec = &log_bin_recs[seq & log_bin_mask];
+
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    rec->fmt   = fmt;
+    rec->level = level;
+    rec->nargs = nargs;
+    memcpy(rec->args, args, nargs * sizeof(*args));
+    __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
 void mctp_set_log_stdio(int level)
 {
-    log_type        = MCTP_LOG_STDIO;
-    log_stdio_level = level;
+    log_type           = MCTP_LOG_STDIO;
+    log_stdio_level    = level;
+    mctp_log_threshold = level;
 }
 
 void mctp_set_log_syslog(void)
 {
-    log_type = MCTP_LOG_SYSLOG;
+    log_type           = MCTP_LOG_SYSLOG;
+    mctp_log_threshold = MCTP_LOG_DEBUG;
 }
 
 void mctp_set_log_custom(void (*fn)(int, const char *, va_list))
 {
-    log_type      = MCTP_LOG_CUSTOM;
-    log_custom_fn = fn;
+    log_type           = MCTP_LOG_CUSTOM;
+    log_custom_fn      = fn;
+    mctp_log_threshold = MCTP_LOG_DEBUG;
+}
+
+int mctp_set_log_binary(struct mctp_log_rec *recs, uint32_t count, int level)
+{
+    /* Sequence numbers are free running, records found by masking */
+    if ( ! count || (count & (count - 1)) )
+        return -EINVAL;
+
+    memset(recs, 0, count * sizeof(*recs));
+    log_bin_recs       = recs;
+    log_bin_mask       = count - 1;
+    log_bin_seq        = 0;
+    log_type           = MCTP_LOG_BINARY_RING;
+    mctp_log_threshold = level;
+
+    return 0;
 }
@@ -73,11 +73,11 @@ struct mctp_binding_serial
     void             *tx_fn_data;
 
     /* receive buffer and state */
-    uint8_t             rxbuf[1024];
-    struct mctp_pktbuf *rx_pkt;
-    uint8_t             rx_exp_len;
-    uint16_t            rx_fcs;
-    uint16_t            rx_fcs_calc;
+    uint8_t                 rxbuf[1024];
+    struct mctp_pktbuf     *rx_pkt;
+    uint8_t                 rx_exp_len;
+    uint16_t                rx_fcs;
+    struct crc_16_ccitt_ctx rx_fcs_calc;
     enum
     {
         STATE_WAIT_SYNC_START,
@@ -122,7 +122,7 @@ static size_t mctp_serial_pkt_escape(struct mctp_pktbuf *pkt, uint8_t *buf)
 
     total_len = pkt->end - pkt->mctp_hdr_off;
 
-    p = (void *) mctp_pktbuf_hdr(pkt);
+    p = (void *) MCTP_PKTBUF_HDR(pkt);
 
     for ( i = 0, j = 0; i < total_len; i++, j++ )
     {
@@ -148,11 +148,11 @@ static int mctp_binding_serial_tx(struct mctp_binding *b, struct mctp_pktbuf *pk
     struct mctp_serial_trailer *tlr;
     uint8_t                    *buf;
     size_t                      len;
-    uint16_t                    fcs;
+    struct crc_16_ccitt_ctx     fcs;
 
     /* the length field in the header excludes serial framing
 	 * and escape sequences */
-    len = mctp_pktbuf_size(pkt);
+    len = MCTP_PKTBUF_SIZE(pkt);
 
     hdr           = (void *) serial->txbuf;
     hdr->flag     = MCTP_SERIAL_FRAMING_FLAG;
@@ -160,8 +160,9 @@ static int mctp_binding_serial_tx(struct mctp_binding *b, struct mctp_pktbuf *pk
     hdr->len      = len;
 
     // Calculate fcs
-    fcs = crc_16_ccitt(FCS_INIT_16, (const uint8_t *) hdr + 1, 2);
-    fcs = crc_16_ccitt(fcs, (const uint8_t *) mctp_pktbuf_hdr(pkt), len);
+    crc_16_ccitt_init(&fcs);
+    crc_16_ccitt_update(&fcs, (const uint8_t *) hdr + 1, 2);
+    crc_16_ccitt_update(&fcs, (const uint8_t *) MCTP_PKTBUF_HDR(pkt), len);
 
     buf = (void *) (hdr + 1);
 
@@ -175,8 +176,8 @@ static int mctp_binding_serial_tx(struct mctp_binding *b, struct mctp_pktbuf *pk
 
     tlr          = (void *) buf;
     tlr->flag    = MCTP_SERIAL_FRAMING_FLAG;
-    tlr->fcs_msb = fcs >> 8;
-    tlr->fcs_lsb = fcs & 0xff;
+    tlr->fcs_msb = crc_16_ccitt_final(&fcs) >> 8;
+    tlr->fcs_lsb = crc_16_ccitt_final(&fcs) & 0xff;
 
     len += sizeof(*hdr) + sizeof(*tlr);
 
@@ -229,8 +230,9 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
         case STATE_WAIT_REVISION:
             if ( c == MCTP_SERIAL_REVISION )
             {
-                serial->rx_state    = STATE_WAIT_LEN;
-                serial->rx_fcs_calc = crc_16_ccitt_byte(FCS_INIT_16, c);
+                serial->rx_state = STATE_WAIT_LEN;
+                crc_16_ccitt_init(&serial->rx_fcs_calc);
+                crc_16_ccitt_update_byte(&serial->rx_fcs_calc, c);
             }
             else if ( c == MCTP_SERIAL_FRAMING_FLAG )
             {
@@ -260,10 +262,10 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
             else
             {
                 mctp_serial_start_packet(serial, 0);
-                pkt                 = serial->rx_pkt;
-                serial->rx_exp_len  = c;
-                serial->rx_state    = STATE_DATA;
-                serial->rx_fcs_calc = crc_16_ccitt_byte(serial->rx_fcs_calc, c);
+                pkt                = serial->rx_pkt;
+                serial->rx_exp_len = c;
+                serial->rx_state   = STATE_DATA;
+                crc_16_ccitt_update_byte(&serial->rx_fcs_calc, c);
             }
             break;
 
@@ -275,7 +277,7 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
             else
             {
                 mctp_pktbuf_push(pkt, &c, 1);
-                serial->rx_fcs_calc = crc_16_ccitt_byte(serial->rx_fcs_calc, c);
+                crc_16_ccitt_update_byte(&serial->rx_fcs_calc, c);
                 if ( pkt->end - pkt->mctp_hdr_off == serial->rx_exp_len )
                     serial->rx_state = STATE_WAIT_FCS1;
             }
@@ -284,7 +286,7 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
         case STATE_DATA_ESCAPED:
             c ^= 0x20;
             mctp_pktbuf_push(pkt, &c, 1);
-            serial->rx_fcs_calc = crc_16_ccitt_byte(serial->rx_fcs_calc, c);
+            crc_16_ccitt_update_byte(&serial->rx_fcs_calc, c);
             if ( pkt->end - pkt->mctp_hdr_off == serial->rx_exp_len )
                 serial->rx_state = STATE_WAIT_FCS1;
             else
@@ -301,7 +303,7 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
             break;
 
         case STATE_WAIT_SYNC_END:
-            if ( serial->rx_fcs == serial->rx_fcs_calc )
+            if ( serial->rx_fcs == crc_16_ccitt_final(&serial->rx_fcs_calc) )
             {
                 if ( c == MCTP_SERIAL_FRAMING_FLAG )
                 {
@@ -316,7 +318,7 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
             else
             {
                 valid = false;
-                mctp_prdebug("invalid fcs : 0x%04x, expect 0x%04x", serial->rx_fcs, serial->rx_fcs_calc);
+                mctp_prdebug("invalid fcs : 0x%04x, expect 0x%04x", serial->rx_fcs, crc_16_ccitt_final(&serial->rx_fcs_calc));
             }
 
             mctp_serial_finish_packet(serial, valid);
@@ -326,11 +328,53 @@ static void mctp_rx_consume_one(struct mctp_binding_serial *serial, uint8_t c)
 
     mctp_prdebug(" -> state: %d", serial->rx_state);
 }
+
+/* Consume a run of unescaped packet data in one go: push and checksum up to
+ * the next escape character or the end of the packet. Returns the number of
+ * bytes consumed, zero if the next byte needs the state machine. */
+static size_t mctp_rx_consume_data(struct mctp_binding_serial *serial, const uint8_t *buf, size_t len)
+{
+    struct mctp_pktbuf *pkt = serial->rx_pkt;
+    const uint8_t      *esc;
+    size_t              run;
+
+    run = serial->rx_exp_len - (pkt->end - pkt->mctp_hdr_off);
+    if ( run > len )
+        run = len;
+
+    esc = memchr(buf, MCTP_SERIAL_ESCAPE, run);
+    if ( esc )
+        run = esc - buf;
+
+    if ( ! run || mctp_pktbuf_push(pkt, (void *) buf, run) )
+        return 0;
+
+    crc_16_ccitt_update(&serial->rx_fcs_calc, buf, run);
+    if ( pkt->end - pkt->mctp_hdr_off == serial->rx_exp_len )
+        serial->rx_state = STATE_WAIT_FCS1;
+
+    return run;
+}
+
 static void mctp_rx_consume(struct mctp_binding_serial *serial, const void *buf, size_t len)
 {
-    size_t i;
+    const uint8_t *p = buf;
+    size_t         i, run;
+
+    for ( i = 0; i < len; )
+    {
+        if ( serial->rx_state == STATE_DATA )
+        {
+            run = mctp_rx_consume_data(serial, p + i, len - i);
+            if ( run )
+            {
+                i += run;
+                continue;
+            }
+        }
 
-    for ( i = 0; i < len; i++ ) mctp_rx_consume_one(serial, *(uint8_t *) (buf + i));
+        mctp_rx_consume_one(serial, p[i++]);
+    }
 }
 
 #ifdef MCTP_HAVE_FILEIO
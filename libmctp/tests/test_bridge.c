@@ -12,6 +12,8 @@
 #include <libmctp.h>
 #include <libmctp-alloc.h>
 
+#include "compiler.h"
+
 #include "test-utils.h"
 
 struct mctp_binding_bridge
@@ -77,6 +79,161 @@ static struct mctp_binding_bridge *mctp_binding_bridge_init(char *name)
     return binding;
 }
 
+static int mctp_binding_bridge_count_tx(struct mctp_binding *b, struct mctp_pktbuf *pkt)
+{
+    struct mctp_binding_bridge *binding = container_of(b, struct mctp_binding_bridge, binding);
+
+    binding->tx_count++;
+    binding->last_pkt_data = *(uint8_t *) mctp_pktbuf_data(pkt);
+
+    return 0;
+}
+
+/* A message of 'n' full packets, starting from 'key' */
+static void mctp_binding_bridge_rx_msg(struct mctp_binding_bridge *binding, uint8_t key, int n, struct mctp_binding_bridge *egress, bool cut_through)
+{
+    struct mctp_pktbuf *pkt;
+    struct mctp_hdr    *hdr;
+    int                 i;
+
+    for ( i = 0; i < n; i++ )
+    {
+        pkt = mctp_pktbuf_alloc(&binding->binding, MCTP_PACKET_SIZE(MCTP_BTU));
+        assert(pkt);
+
+        hdr                = mctp_pktbuf_hdr(pkt);
+        hdr->ver           = 1;
+        hdr->src           = 1;
+        hdr->dest          = 2;
+        hdr->flags_seq_tag = (i % 4) << MCTP_HDR_SEQ_SHIFT;
+        if ( i == 0 )
+            hdr->flags_seq_tag |= MCTP_HDR_FLAG_SOM;
+        if ( i == n - 1 )
+            hdr->flags_seq_tag |= MCTP_HDR_FLAG_EOM;
+
+        memset(mctp_pktbuf_data(pkt), key + i, MCTP_BTU);
+        mctp_bus_rx(&binding->binding, pkt);
+
+        /* Cut-through, each packet leaves as it comes in */
+        if ( cut_through )
+            assert(egress->tx_count == i + 1);
+        else if ( i < n - 1 )
+            assert(egress->tx_count == 0);
+    }
+}
+
+static int rx_buf_gets;
+
+static int test_rx_buf_get(uint8_t src_eid __unused, uint8_t msg_tag __unused, void *data __unused, struct mctp_rx_buf *rx_buf __unused)
+{
+    rx_buf_gets++;
+    return -1;
+}
+
+static void test_rx_buf_put(void *data __unused, void *buf __unused)
+{
+}
+
+static void test_cut_through(void)
+{
+    struct mctp_binding_bridge *b0, *b1;
+    struct mctp_stats           stats;
+    struct mctp                *mctp = mctp_init();
+
+    b0                   = mctp_binding_bridge_init("binding0");
+    b1                   = mctp_binding_bridge_init("binding1");
+    b0->binding.tx       = mctp_binding_bridge_count_tx;
+    b1->binding.tx       = mctp_binding_bridge_count_tx;
+    b1->binding.pkt_size = MCTP_PACKET_SIZE(2 * MCTP_BTU);
+    mctp_bridge_busses(mctp, &b0->binding, &b1->binding);
+    mctp_binding_set_tx_enabled(&b0->binding, true);
+    mctp_binding_set_tx_enabled(&b1->binding, true);
+
+    /* Fits the larger MTU, forwarded packet by packet */
+    mctp_binding_bridge_rx_msg(b0, 0x10, 4, b1, true);
+    assert(b1->last_pkt_data == 0x13);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.bridge_cut == 4);
+
+    /* Does not fit the smaller one, reassembled and packetized again */
+    {
+        struct mctp_pktbuf *pkt = mctp_pktbuf_alloc(&b1->binding, MCTP_PACKET_SIZE(2 * MCTP_BTU));
+        struct mctp_hdr    *hdr = mctp_pktbuf_hdr(pkt);
+
+        hdr->ver           = 1;
+        hdr->src           = 2;
+        hdr->dest          = 1;
+        hdr->flags_seq_tag = MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM;
+        memset(mctp_pktbuf_data(pkt), 0x30, 2 * MCTP_BTU);
+        mctp_bus_rx(&b1->binding, pkt);
+    }
+    assert(b0->tx_count == 2);
+    assert(b0->last_pkt_data == 0x30);
+
+    /* Nor does a message whose last packet alone would, it is kept whole */
+    {
+        struct mctp_pktbuf *pkt;
+        struct mctp_hdr    *hdr;
+        int                 i;
+
+        for ( i = 0; i < 2; i++ )
+        {
+            pkt                = mctp_pktbuf_alloc(&b1->binding, MCTP_PACKET_SIZE(i ? 10 : 2 * MCTP_BTU));
+            hdr                = mctp_pktbuf_hdr(pkt);
+            hdr->ver           = 1;
+            hdr->src           = 2;
+            hdr->dest          = 1;
+            hdr->flags_seq_tag = (i ? MCTP_HDR_FLAG_EOM : MCTP_HDR_FLAG_SOM) | (i << MCTP_HDR_SEQ_SHIFT);
+            memset(mctp_pktbuf_data(pkt), 0x31 + i, i ? 10 : 2 * MCTP_BTU);
+            mctp_bus_rx(&b1->binding, pkt);
+        }
+    }
+    assert(b0->tx_count == 5);
+    assert(b0->last_pkt_data == 0x32);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.bridge_cut == 4);
+
+    /* Turned off, messages are stored and forwarded, in buffers of the core */
+    b1->tx_count = 0;
+    mctp_set_bridge_cut_through(mctp, false);
+    mctp_set_rx_buf_ops(mctp, test_rx_buf_get, test_rx_buf_put, NULL);
+    mctp_binding_bridge_rx_msg(b0, 0x40, 4, b1, false);
+    assert(b1->tx_count == 2);
+    assert(rx_buf_gets == 0);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.bridge_cut == 4);
+
+    __mctp_free(b1);
+    __mctp_free(b0);
+    mctp_destroy(mctp);
+}
+
+static void test_unregister_route(void)
+{
+    struct mctp_binding_bridge *b0, *b1;
+    struct mctp                *mctp = mctp_init();
+
+    b0 = mctp_binding_bridge_init("binding0");
+    b1 = mctp_binding_bridge_init("binding1");
+    mctp_bridge_busses(mctp, &b0->binding, &b1->binding);
+    assert(! mctp_route_add(mctp, 2, 2, &b1->binding));
+
+    /* The route goes with its bus, the EID is flooded once bridged again */
+    mctp_unregister_bus(mctp, &b1->binding);
+    mctp_unregister_bus(mctp, &b0->binding);
+    mctp_bridge_busses(mctp, &b0->binding, &b1->binding);
+    mctp_binding_set_tx_enabled(&b0->binding, true);
+    mctp_binding_set_tx_enabled(&b1->binding, true);
+
+    mctp_binding_bridge_rx(b0, 0x66);
+    assert(b1->tx_count == 1);
+    assert(b1->last_pkt_data == 0x66);
+
+    __mctp_free(b1);
+    __mctp_free(b0);
+    mctp_destroy(mctp);
+}
+
 int main(void)
 {
     struct test_ctx _ctx, *ctx = &_ctx;
@@ -103,5 +260,8 @@ int main(void)
     __mctp_free(ctx->bindings[0]);
     mctp_destroy(ctx->mctp);
 
+    test_cut_through();
+    test_unregister_route();
+
     return EXIT_SUCCESS;
 }
@@ -7,6 +7,7 @@
 #include "libmctp-alloc.h"
 #include "libmctp-cmds.h"
 
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -101,9 +102,143 @@ static void send_transport_control_message(void)
     mctp_destroy(endpoint);
 }
 
+struct responder_ctx
+{
+    uint8_t rx_invoked;
+    uint8_t tx_invoked;
+    uint8_t tx_buf[64];
+    size_t  tx_len;
+};
+
+static int responder_tx(struct mctp_binding *b, struct mctp_pktbuf *pkt)
+{
+    struct responder_ctx *ctx = b->control_rx_data;
+
+    ctx->tx_invoked++;
+    ctx->tx_len = mctp_pktbuf_size(pkt);
+    assert(ctx->tx_len <= sizeof(ctx->tx_buf));
+    memcpy(ctx->tx_buf, mctp_pktbuf_hdr(pkt), ctx->tx_len);
+
+    return 0;
+}
+
+static void responder_rx(uint8_t eid __unused, bool tag_owner __unused, uint8_t msg_tag __unused, void *data, void *msg __unused, size_t len __unused)
+{
+    struct responder_ctx *ctx = data;
+
+    ctx->rx_invoked++;
+}
+
+/* Send a request of 'len' bytes from eid_2, the first one past the header being 'arg' */
+static void send_ctrl_request(struct mctp_binding *b, struct responder_ctx *ctx, uint8_t command, uint8_t arg, size_t len)
+{
+    struct
+    {
+        struct mctp_hdr hdr;
+        uint8_t         msg[MCTP_CTRL_REQ_HDR_SIZE + 1];
+    } req = {
+        .hdr =
+            {
+                .ver           = 1,
+                .dest          = eid_1,
+                .src           = eid_2,
+                .flags_seq_tag = MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | MCTP_HDR_FLAG_TO | 3,
+            },
+        .msg = {MCTP_CTRL_HDR_MSG_TYPE, MCTP_CTRL_HDR_FLAG_REQUEST | 0x11, command, arg},
+    };
+
+    ctx->rx_invoked = 0;
+    ctx->tx_invoked = 0;
+    rcv_ctrl_msg(b, &req, sizeof(req.hdr) + len);
+}
+
+static void check_ctrl_response(struct responder_ctx *ctx, uint8_t command, const uint8_t *data, size_t len)
+{
+    struct mctp_hdr          *hdr  = (struct mctp_hdr *) ctx->tx_buf;
+    struct mctp_ctrl_msg_hdr *resp = (struct mctp_ctrl_msg_hdr *) (hdr + 1);
+
+    assert(ctx->tx_invoked == 1);
+    assert(ctx->rx_invoked == 0);
+    assert(ctx->tx_len == sizeof(*hdr) + sizeof(*resp) + len);
+    assert(hdr->dest == eid_2);
+    assert(hdr->src == eid_1);
+    assert(hdr->flags_seq_tag == (MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | 3));
+    assert(resp->ic_msg_type == MCTP_CTRL_HDR_MSG_TYPE);
+    assert(resp->rq_dgram_inst == 0x11);
+    assert(resp->command_code == command);
+    assert(resp->completion_code == MCTP_CTRL_CC_SUCCESS);
+    assert(! memcmp(resp + 1, data, len));
+}
+
+static void builtin_control_responder(void)
+{
+    static const uint8_t         types[] = {0x01, 0x7E};
+    static const uint8_t         uuid[16] = {0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE, 0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF};
+    static const uint8_t         eid_resp[] = {eid_1, 0x00, 0x00};
+    static const uint8_t         version_resp[] = {1, 0xF1, 0xF3, 0xF1, 0x00};
+    static const uint8_t         types_resp[] = {3, MCTP_CTRL_HDR_MSG_TYPE, 0x01, 0x7E};
+    struct mctp_ctrl_info        info = {types, sizeof(types), uuid};
+    struct mctp                 *endpoint = mctp_init();
+    struct mctp_binding          binding;
+    struct responder_ctx         ctx;
+    struct mctp_stats            stats;
+
+    memset(&ctx, 0, sizeof(ctx));
+    setup_test_binding(&binding, endpoint, &ctx);
+    binding.tx         = responder_tx;
+    binding.control_rx = NULL;
+    mctp_set_rx_all(endpoint, responder_rx, &ctx);
+
+    /* Disabled, everything goes to the application */
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_ENDPOINT_ID, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    assert(ctx.rx_invoked == 1 && ctx.tx_invoked == 0);
+
+    assert(mctp_set_ctrl_responder(endpoint, &info) == 0);
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_ENDPOINT_ID, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    check_ctrl_response(&ctx, MCTP_CTRL_CMD_GET_ENDPOINT_ID, eid_resp, sizeof(eid_resp));
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_ENDPOINT_UUID, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    check_ctrl_response(&ctx, MCTP_CTRL_CMD_GET_ENDPOINT_UUID, uuid, sizeof(uuid));
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, MCTP_CTRL_VERSION_TYPE_BASE, MCTP_CTRL_REQ_HDR_SIZE + 1);
+    check_ctrl_response(&ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, version_resp, sizeof(version_resp));
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, MCTP_CTRL_HDR_MSG_TYPE, MCTP_CTRL_REQ_HDR_SIZE + 1);
+    check_ctrl_response(&ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, version_resp, sizeof(version_resp));
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    check_ctrl_response(&ctx, MCTP_CTRL_CMD_GET_MESSAGE_TYPE_SUPPORT, types_resp, sizeof(types_resp));
+
+    /* Versions of the application's types, malformed and other commands are left to it */
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, 0x01, MCTP_CTRL_REQ_HDR_SIZE + 1);
+    assert(ctx.rx_invoked == 1 && ctx.tx_invoked == 0);
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_VERSION_SUPPORT, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    assert(ctx.rx_invoked == 1 && ctx.tx_invoked == 0);
+
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_SET_ENDPOINT_ID, 0, MCTP_CTRL_REQ_HDR_SIZE + 1);
+    assert(ctx.rx_invoked == 1 && ctx.tx_invoked == 0);
+
+    mctp_get_stats(endpoint, &stats);
+    assert(stats.ctrl_responses == 5);
+
+    /* Without a UUID, Get Endpoint UUID is the application's */
+    info.uuid = NULL;
+    assert(mctp_set_ctrl_responder(endpoint, &info) == 0);
+    send_ctrl_request(&binding, &ctx, MCTP_CTRL_CMD_GET_ENDPOINT_UUID, 0, MCTP_CTRL_REQ_HDR_SIZE);
+    assert(ctx.rx_invoked == 1 && ctx.tx_invoked == 0);
+
+    info.n_msg_types = MCTP_CTRL_MSG_TYPES_MAX + 1;
+    assert(mctp_set_ctrl_responder(endpoint, &info) == -EINVAL);
+
+    mctp_destroy(endpoint);
+}
+
 int main(void)
 {
     send_transport_control_message();
+    builtin_control_responder();
 
     return EXIT_SUCCESS;
 }
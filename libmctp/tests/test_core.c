@@ -11,6 +11,7 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -21,9 +22,11 @@
 
 #include "compiler.h"
 #include "libmctp-alloc.h"
+#include "libmctp-cmds.h"
 #include "libmctp-log.h"
 #include "range.h"
 #include "test-utils.h"
+#include "crc32c.h"
 
 #define TEST_DEST_EID           9
 #define TEST_DEST_NULL_EID      0
@@ -98,6 +101,7 @@ static void receive_ptkbuf(struct mctp_binding_test *binding, const struct pktbu
     rx_pkt->end          = MCTP_PACKET_SIZE(len);
     rx_pkt->mctp_hdr_off = 0;
     rx_pkt->next         = NULL;
+    rx_pkt->mctp         = NULL;
     memcpy(rx_pkt->data, &pktbuf->hdr, sizeof(pktbuf->hdr));
     memcpy(rx_pkt->data + sizeof(pktbuf->hdr), pktbuf->payload, alloc_size);
 
@@ -124,6 +128,17 @@ static void receive_two_fragment_message(struct mctp_binding_test *binding, uint
     receive_one_fragment(binding, payload + fragment1_size, fragment2_size, flags_seq_tag, pktbuf);
 }
 
+/* Append the CRC-32C integrity check trailer, LSB first, to the 'body' first bytes of 'payload' */
+static void set_integrity_check(uint8_t *payload, size_t body)
+{
+    uint32_t ic = crc32c(payload, body);
+
+    payload[body + 0] = ic & 0xff;
+    payload[body + 1] = (ic >> 8) & 0xff;
+    payload[body + 2] = (ic >> 16) & 0xff;
+    payload[body + 3] = ic >> 24;
+}
+
 static void mctp_core_test_simple_rx()
 {
     struct mctp              *mctp    = NULL;
@@ -364,7 +379,7 @@ static void mctp_core_test_exhaust_context_buffers()
     static uint8_t            test_payload[MAX_PAYLOAD_SIZE];
     uint8_t                   tag                 = MCTP_HDR_FLAG_TO | get_tag();
     uint8_t                   i                   = 0;
-    const uint8_t             max_context_buffers = 16;
+    const uint8_t             max_context_buffers = MCTP_MSG_CTX_COUNT;
     struct pktbuf             pktbuf;
     uint8_t                   flags_seq_tag;
 
@@ -377,7 +392,7 @@ static void mctp_core_test_exhaust_context_buffers()
     pktbuf.hdr.dest = TEST_DEST_EID;
     pktbuf.hdr.src  = TEST_SRC_EID;
 
-    /* Exhaust all 16 context buffers*/
+    /* Exhaust all the context buffers */
     for ( i = 0; i < max_context_buffers; i++ )
     {
         flags_seq_tag = MCTP_HDR_FLAG_SOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag;
@@ -406,6 +421,177 @@ static void mctp_core_test_exhaust_context_buffers()
     mctp_destroy(mctp);
 }
 
+static void rx_message_count(uint8_t eid __unused, bool tag_owner __unused, uint8_t msg_tag __unused, void *data, void *msg __unused, size_t len)
+{
+    size_t *count = data;
+
+    assert(len == 3 * MCTP_BTU);
+    (*count)++;
+}
+
+static void mctp_core_test_rx_interleaved()
+{
+    struct mctp              *mctp    = NULL;
+    struct mctp_binding_test *binding = NULL;
+    static uint8_t            test_payload[MCTP_BTU];
+    uint8_t                   tag = MCTP_HDR_FLAG_TO | get_tag();
+    struct pktbuf             pktbuf;
+    size_t                    count = 0;
+    int                       i;
+
+    memset(test_payload, 0, sizeof(test_payload));
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message_count, &count);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+
+    /* Start a message from every source, keeping all the contexts busy */
+    for ( i = 0; i < MCTP_MSG_CTX_COUNT; i++ )
+    {
+        pktbuf.hdr.src = TEST_SRC_EID + i;
+        receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    }
+
+    for ( i = 0; i < MCTP_MSG_CTX_COUNT; i++ )
+    {
+        pktbuf.hdr.src = TEST_SRC_EID + i;
+        receive_one_fragment(binding, test_payload, MCTP_BTU, (1 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    }
+
+    assert(count == 0);
+
+    /* Complete them in the reverse order, so lookups follow removals */
+    for ( i = MCTP_MSG_CTX_COUNT - 1; i >= 0; i-- )
+    {
+        pktbuf.hdr.src = TEST_SRC_EID + i;
+        receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_EOM | (2 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    }
+
+    assert(count == MCTP_MSG_CTX_COUNT);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+/* Append a packet to a batch, as a binding would from one transfer */
+static void rx_batch_add(struct mctp_binding_test *binding, struct mctp_pktbuf ***link, uint8_t src, uint8_t flags_seq_tag, const uint8_t *payload)
+{
+    struct mctp_pktbuf *pkt;
+    struct mctp_hdr    *hdr;
+
+    pkt = mctp_pktbuf_alloc((struct mctp_binding *) binding, MCTP_PACKET_SIZE(MCTP_BTU));
+    assert(pkt);
+
+    hdr                = MCTP_PKTBUF_HDR(pkt);
+    hdr->ver           = 1;
+    hdr->dest          = TEST_DEST_EID;
+    hdr->src           = src;
+    hdr->flags_seq_tag = flags_seq_tag;
+    memcpy(MCTP_PKTBUF_DATA(pkt), payload, MCTP_BTU);
+
+    **link = pkt;
+    *link  = &pkt->next;
+}
+
+static void mctp_core_test_rx_batch()
+{
+    struct mctp              *mctp    = NULL;
+    struct mctp_binding_test *binding = NULL;
+    static uint8_t            test_payload[MCTP_BTU];
+    uint8_t                   tag = MCTP_HDR_FLAG_TO | get_tag();
+    struct mctp_pktbuf       *head = NULL, **link = &head;
+    size_t                    count = 0;
+
+    memset(test_payload, 0, sizeof(test_payload));
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message_count, &count);
+
+    /* Two messages whose packets interleave part of the way */
+    rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID, (1 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID + 1, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_EOM | (2 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID + 1, (1 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID + 1, MCTP_HDR_FLAG_EOM | (2 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+
+    /* A sequence break drops the message even with its context cached */
+    rx_batch_add(binding, &link, TEST_SRC_EID + 2, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID + 2, (2 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID + 2, MCTP_HDR_FLAG_EOM | (3 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+
+    mctp_bus_rx_batch((struct mctp_binding *) binding, head, 9);
+    assert(count == 2);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+static uint64_t test_now(void *data)
+{
+    return *(uint64_t *) data;
+}
+
+static void mctp_core_test_rx_timeout()
+{
+    struct mctp              *mctp    = NULL;
+    struct mctp_binding_test *binding = NULL;
+    static uint8_t            test_payload[MCTP_BTU];
+    uint8_t                   tag = MCTP_HDR_FLAG_TO | get_tag();
+    struct pktbuf             pktbuf;
+    struct mctp_stats         stats;
+    uint64_t                  now   = 1000;
+    size_t                    count = 0;
+    int                       i;
+
+    memset(test_payload, 0, sizeof(test_payload));
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message_count, &count);
+    mctp_set_now_op(mctp, test_now, &now);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+
+    /* Messages whose EOM is lost hold every context */
+    for ( i = 0; i < MCTP_MSG_CTX_COUNT; i++ )
+    {
+        pktbuf.hdr.src = TEST_SRC_EID + i;
+        receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    }
+
+    pktbuf.hdr.src = TEST_SRC_EID + MCTP_MSG_CTX_COUNT;
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.rx_ctx_exhausted == 1);
+
+    /* Not before the timeout, polled every tick */
+    for ( ; now < 1000 + MCTP_MSG_CTX_TIMEOUT; now += MCTP_MSG_CTX_WHEEL_TICK ) assert(mctp_poll(mctp) == 0);
+
+    /* A message started late is reclaimed a timeout later */
+    pktbuf.hdr.src = TEST_SRC_EID;
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+
+    now += 2 * MCTP_MSG_CTX_WHEEL_TICK;
+    assert(mctp_poll(mctp) == MCTP_MSG_CTX_COUNT - 1);
+
+    now += MCTP_MSG_CTX_TIMEOUT;
+    assert(mctp_poll(mctp) == 1);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.rx_ctx_timeouts == MCTP_MSG_CTX_COUNT);
+
+    /* The contexts are usable again */
+    for ( i = 0; i < MCTP_MSG_CTX_COUNT; i++ )
+    {
+        pktbuf.hdr.src = TEST_SRC_EID + i;
+        receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+        receive_one_fragment(binding, test_payload, MCTP_BTU, (1 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+        receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_EOM | (2 << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    }
+
+    assert(count == MCTP_MSG_CTX_COUNT);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
 static void mctp_core_test_rx_with_tag()
 {
     struct mctp              *mctp    = NULL;
@@ -548,6 +734,836 @@ static void mctp_core_test_rx_with_broadcast_dst_eid()
     mctp_destroy(mctp);
 }
 
+static void mctp_core_test_rx_integrity_check()
+{
+    struct mctp              *mctp    = NULL;
+    struct mctp_binding_test *binding = NULL;
+    struct test_params        test_param;
+    uint8_t                   test_payload[2 * MCTP_BTU];
+    size_t                    body = (2 * MCTP_BTU) - MCTP_MSG_IC_SIZE;
+    struct pktbuf             pktbuf;
+
+    /* Message type with the IC bit set, CRC-32C trailer LSB first */
+    memset(test_payload, 0x5a, sizeof(test_payload));
+    test_payload[0] = MCTP_MSG_IC_BIT | 0x7e;
+    set_integrity_check(test_payload, body);
+
+    test_param.seen         = false;
+    test_param.message_size = 0;
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message, &test_param);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+    pktbuf.hdr.src  = TEST_SRC_EID;
+
+    /* Left to the application until enabled for the type */
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(test_param.seen);
+    assert(test_param.message_size == 2 * MCTP_BTU);
+
+    assert(mctp_set_msg_ic(mctp, MCTP_MSG_IC_BIT | 0x7e, true) == -EINVAL);
+    assert(mctp_set_msg_ic(mctp, 0x7e, true) == 0);
+
+    /* The trailer is verified and stripped */
+    test_param.seen = false;
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(test_param.seen);
+    assert(test_param.message_size == body);
+
+    /* A corrupted message is dropped */
+    test_param.seen = false;
+    test_payload[MCTP_BTU + 1] ^= 1;
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(! test_param.seen);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+struct test_scatter_params
+{
+    uint8_t buf[3 * MCTP_BTU];
+    size_t  len;
+    size_t  pkts;
+};
+
+static void rx_message_pkts(uint8_t eid __unused, bool tag_owner __unused, uint8_t msg_tag __unused, void *data, struct mctp_pktbuf *pkts, size_t len)
+{
+    struct test_scatter_params *param = data;
+    struct mctp_pktbuf         *pkt;
+
+    param->len  = 0;
+    param->pkts = 0;
+    for ( pkt = pkts; pkt; pkt = pkt->next )
+    {
+        memcpy(param->buf + param->len, MCTP_PKTBUF_DATA(pkt), MCTP_PKTBUF_PAYLOAD_SIZE(pkt));
+        param->len += MCTP_PKTBUF_PAYLOAD_SIZE(pkt);
+        param->pkts++;
+    }
+
+    assert(param->len == len);
+}
+
+static void mctp_core_test_rx_scatter()
+{
+    struct mctp                      *mctp    = NULL;
+    struct mctp_binding_test         *binding = NULL;
+    static struct test_scatter_params test_param;
+    static uint8_t                    test_payload[3 * MCTP_BTU];
+    size_t                            len  = (2 * MCTP_BTU) + 2;
+    size_t                            body = len - MCTP_MSG_IC_SIZE;
+    uint8_t                           tag  = MCTP_HDR_FLAG_TO | get_tag();
+    struct pktbuf                     pktbuf;
+    size_t                            i;
+
+    for ( i = 0; i < sizeof(test_payload); i++ ) test_payload[i] = i;
+
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_pkts(mctp, rx_message_pkts, &test_param);
+    mctp_set_msg_ic(mctp, 0x7e, true);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+    pktbuf.hdr.src  = TEST_SRC_EID;
+
+    /* Handed over as the received fragments */
+    test_payload[0] = 0x7e;
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(test_param.pkts == 2);
+    assert(test_param.len == 2 * MCTP_BTU);
+    assert(! memcmp(test_param.buf, test_payload, 2 * MCTP_BTU));
+
+    /* The integrity check trailer straddles the last two packets */
+    test_payload[0] = MCTP_MSG_IC_BIT | 0x7e;
+    set_integrity_check(test_payload, body);
+
+    test_param.len = 0;
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    receive_one_fragment(binding, test_payload + MCTP_BTU, MCTP_BTU, (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    receive_one_fragment(binding, test_payload + (2 * MCTP_BTU), 2, MCTP_HDR_FLAG_EOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag,
+                         &pktbuf);
+
+    assert(test_param.pkts == 3);
+    assert(test_param.len == body);
+    assert(! memcmp(test_param.buf, test_payload, body));
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+struct test_rx_buf_params
+{
+    uint8_t buf[2 * MCTP_BTU + 1];
+    int     gets;
+    int     puts;
+    void   *msg;
+    size_t  len;
+};
+
+static int rx_buf_get(uint8_t src_eid __unused, uint8_t msg_tag __unused, void *data, struct mctp_rx_buf *rx_buf)
+{
+    struct test_rx_buf_params *param = data;
+
+    param->gets++;
+    rx_buf->buf    = param->buf;
+    rx_buf->offset = 1;
+    rx_buf->size   = sizeof(param->buf) - 1;
+
+    return 0;
+}
+
+static void rx_buf_put(void *data, void *buf)
+{
+    struct test_rx_buf_params *param = data;
+
+    assert(buf == param->buf);
+    param->puts++;
+}
+
+static void rx_message_rx_buf(uint8_t eid __unused, bool tag_owner __unused, uint8_t msg_tag __unused, void *data, void *msg, size_t len)
+{
+    struct test_rx_buf_params *param = data;
+
+    /* Still owned by the core until put */
+    assert(param->puts == param->gets - 1);
+    param->msg = msg;
+    param->len = len;
+}
+
+static void mctp_core_test_rx_buf_ops()
+{
+    struct mctp                     *mctp    = NULL;
+    struct mctp_binding_test        *binding = NULL;
+    static struct test_rx_buf_params test_param;
+    static uint8_t                   test_payload[2 * MCTP_BTU];
+    uint8_t                          tag = MCTP_HDR_FLAG_TO | get_tag();
+    struct pktbuf                    pktbuf;
+    size_t                           i;
+
+    for ( i = 0; i < sizeof(test_payload); i++ ) test_payload[i] = i & 0x7f;
+
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message_rx_buf, &test_param);
+    assert(mctp_set_rx_buf_ops(mctp, rx_buf_get, NULL, &test_param) == -EINVAL);
+    mctp_set_rx_buf_ops(mctp, rx_buf_get, rx_buf_put, &test_param);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+    pktbuf.hdr.src  = TEST_SRC_EID;
+
+    /* Reassembled in place at the requested offset */
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(test_param.gets == 1 && test_param.puts == 1);
+    assert(test_param.msg == test_param.buf + 1);
+    assert(test_param.len == 2 * MCTP_BTU);
+    assert(! memcmp(test_param.buf + 1, test_payload, 2 * MCTP_BTU));
+
+    /* A dropped message gives the buffer back as well */
+    test_param.msg = NULL;
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    get_sequence();
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_EOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+
+    assert(test_param.gets == 2 && test_param.puts == 2);
+    assert(! test_param.msg);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+#define TEST_STREAM_TYPE 0x05
+#define TEST_STREAM_PKTS 40 /* Well past a context buffer */
+
+struct test_stream_params
+{
+    uint8_t      buf[TEST_STREAM_PKTS * MCTP_BTU];
+    size_t       len;
+    size_t       chunks;
+    unsigned int flags; /* Of all the chunks */
+    bool         eom;
+    bool         aborted;
+    struct mctp *mctp;
+    size_t       stop_after; /* Chunks before the handler stops streaming, 0 never */
+};
+
+static void rx_message_stream(uint8_t eid __unused, bool tag_owner, uint8_t msg_tag __unused, void *data, unsigned int flags, const void *chunk,
+                              size_t len)
+{
+    struct test_stream_params *param = data;
+
+    assert(tag_owner);
+
+    if ( flags & MCTP_RX_STREAM_ABORT )
+    {
+        assert(! chunk && ! len);
+        param->aborted = true;
+        return;
+    }
+
+    /* In order, the first one flagged */
+    assert(! param->eom);
+    assert(!! (flags & MCTP_RX_STREAM_SOM) == (param->chunks == 0));
+
+    memcpy(param->buf + param->len, chunk, len);
+    param->len += len;
+    param->chunks++;
+    param->flags |= flags;
+    param->eom = flags & MCTP_RX_STREAM_EOM;
+
+    if ( param->chunks == param->stop_after )
+        assert(mctp_set_rx_stream(param->mctp, TEST_STREAM_TYPE, NULL, NULL) == 0);
+}
+
+static void receive_stream_message(struct mctp_binding_test *binding, uint8_t *payload, size_t len, struct pktbuf *pktbuf)
+{
+    uint8_t tag = MCTP_HDR_FLAG_TO | get_tag();
+    uint8_t flags;
+    size_t  off, n;
+
+    for ( off = 0; off < len; off += n )
+    {
+        n     = MIN((size_t) MCTP_BTU, len - off);
+        flags = (off == 0 ? MCTP_HDR_FLAG_SOM : 0) | (off + n == len ? MCTP_HDR_FLAG_EOM : 0);
+        receive_one_fragment(binding, payload + off, n, flags | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, pktbuf);
+    }
+}
+
+static void mctp_core_test_rx_stream()
+{
+    struct mctp                     *mctp    = NULL;
+    struct mctp_binding_test        *binding = NULL;
+    static struct test_stream_params test_param;
+    static uint8_t                   test_payload[TEST_STREAM_PKTS * MCTP_BTU];
+    struct test_params               rx_param;
+    size_t                           len  = (2 * MCTP_BTU) + 2;
+    size_t                           body = len - MCTP_MSG_IC_SIZE;
+    uint8_t                          tag  = MCTP_HDR_FLAG_TO | get_tag();
+    struct pktbuf                    pktbuf;
+    size_t                           i;
+
+    for ( i = 0; i < sizeof(test_payload); i++ ) test_payload[i] = i;
+
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message, &rx_param);
+    assert(mctp_set_rx_stream(mctp, MCTP_CTRL_HDR_MSG_TYPE, rx_message_stream, &test_param) == -EINVAL);
+    assert(mctp_set_rx_stream(mctp, TEST_STREAM_TYPE, rx_message_stream, &test_param) == 0);
+    mctp_set_msg_ic(mctp, TEST_STREAM_TYPE, true);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+    pktbuf.hdr.src  = TEST_SRC_EID;
+
+    /* Far larger than a context buffer, one chunk per packet */
+    test_payload[0] = TEST_STREAM_TYPE;
+    receive_stream_message(binding, test_payload, sizeof(test_payload), &pktbuf);
+
+    assert(test_param.eom && ! test_param.aborted);
+    assert(test_param.chunks == TEST_STREAM_PKTS);
+    assert(test_param.len == sizeof(test_payload));
+    assert(! memcmp(test_param.buf, test_payload, sizeof(test_payload)));
+
+    /* A single packet message is its first and last chunk */
+    memset(&test_param, 0, sizeof(test_param));
+    receive_stream_message(binding, test_payload, MCTP_BTU, &pktbuf);
+
+    assert(test_param.chunks == 1 && test_param.flags == (MCTP_RX_STREAM_SOM | MCTP_RX_STREAM_EOM));
+
+    /* The integrity check trailer, straddling the last two packets, is held back and left out */
+    test_payload[0] = MCTP_MSG_IC_BIT | TEST_STREAM_TYPE;
+    set_integrity_check(test_payload, body);
+
+    memset(&test_param, 0, sizeof(test_param));
+    receive_stream_message(binding, test_payload, len, &pktbuf);
+
+    assert(test_param.eom && ! test_param.aborted);
+    assert(test_param.len == body);
+    assert(! memcmp(test_param.buf, test_payload, body));
+
+    /* Failing it ends the message with an abort rather than its last chunk */
+    test_payload[MCTP_BTU] ^= 1;
+    memset(&test_param, 0, sizeof(test_param));
+    receive_stream_message(binding, test_payload, len, &pktbuf);
+
+    assert(test_param.aborted && ! test_param.eom);
+    test_payload[MCTP_BTU] ^= 1;
+
+    /* So does a packet out of sequence */
+    test_payload[0] = TEST_STREAM_TYPE;
+    memset(&test_param, 0, sizeof(test_param));
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    get_sequence();
+    receive_one_fragment(binding, test_payload, MCTP_BTU, (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+
+    assert(test_param.chunks == 1 && test_param.aborted);
+
+    /* As do the messages in progress when the type is no longer streamed */
+    memset(&test_param, 0, sizeof(test_param));
+    receive_one_fragment(binding, test_payload, MCTP_BTU, MCTP_HDR_FLAG_SOM | (get_sequence() << MCTP_HDR_SEQ_SHIFT) | tag, &pktbuf);
+    assert(mctp_set_rx_stream(mctp, TEST_STREAM_TYPE, NULL, NULL) == 0);
+
+    assert(test_param.chunks == 1 && test_param.aborted);
+
+    /* Then reassembled as any other */
+    rx_param.seen = false;
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+
+    assert(rx_param.seen && rx_param.message_size == 2 * MCTP_BTU);
+
+    for ( i = 0; i < MCTP_RX_STREAM_COUNT; i++ ) assert(mctp_set_rx_stream(mctp, TEST_STREAM_TYPE + i, rx_message_stream, &test_param) == 0);
+    assert(mctp_set_rx_stream(mctp, TEST_STREAM_TYPE + i, rx_message_stream, &test_param) == -ENOSPC);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+static void mctp_core_test_rx_stream_stop()
+{
+    struct mctp                     *mctp    = NULL;
+    struct mctp_binding_test        *binding = NULL;
+    static struct test_stream_params test_param;
+    static uint8_t                   test_payload[MCTP_BTU];
+    struct test_params               rx_param;
+    uint8_t                          tag = MCTP_HDR_FLAG_TO | get_tag();
+    struct mctp_pktbuf              *head, **link;
+    size_t                           stop;
+
+    memset(test_payload, 0, sizeof(test_payload));
+    test_payload[0] = TEST_STREAM_TYPE;
+
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message, &rx_param);
+
+    /* The handler stops streaming the type from its first, middle and last
+     * chunk, the rest of the batch must not touch the context it dropped */
+    for ( stop = 1; stop <= 3; stop++ )
+    {
+        memset(&test_param, 0, sizeof(test_param));
+        test_param.mctp       = mctp;
+        test_param.stop_after = stop;
+        rx_param.seen         = false;
+        assert(mctp_set_rx_stream(mctp, TEST_STREAM_TYPE, rx_message_stream, &test_param) == 0);
+
+        head = NULL;
+        link = &head;
+        rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+        rx_batch_add(binding, &link, TEST_SRC_EID, (1 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+        rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_EOM | (2 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+        mctp_bus_rx_batch((struct mctp_binding *) binding, head, 3);
+
+        /* The message in progress is aborted, what is left of it dropped */
+        assert(test_param.chunks == stop);
+        assert(test_param.eom == (stop == 3));
+        assert(test_param.aborted);
+        assert(! rx_param.seen);
+    }
+
+    /* No context is left behind */
+    rx_param.seen = false;
+    head          = NULL;
+    link          = &head;
+    rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_SOM | (0 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    rx_batch_add(binding, &link, TEST_SRC_EID, MCTP_HDR_FLAG_EOM | (1 << MCTP_HDR_SEQ_SHIFT) | tag, test_payload);
+    mctp_bus_rx_batch((struct mctp_binding *) binding, head, 2);
+
+    assert(rx_param.seen && rx_param.message_size == 2 * MCTP_BTU);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+struct mctp_binding_gather
+{
+    struct mctp_binding binding;
+    uint8_t             msg[4 * MCTP_BTU];
+    size_t              len;
+    int                 pkts;
+    int                 ext_pkts;
+    int                 done;
+};
+
+static int mctp_binding_gather_tx(struct mctp_binding *b, struct mctp_pktbuf *pkt)
+{
+    struct mctp_binding_gather *binding = container_of(b, struct mctp_binding_gather, binding);
+    size_t                      len     = MCTP_PKTBUF_PAYLOAD_SIZE(pkt);
+
+    /* Completion only follows the last packet */
+    assert(! binding->done);
+
+    memcpy(binding->msg + binding->len, MCTP_PKTBUF_DATA(pkt), len);
+    memcpy(binding->msg + binding->len + len, pkt->ext_data, pkt->ext_len);
+    binding->len += len + pkt->ext_len;
+    binding->ext_pkts += (pkt->ext_len != 0);
+    binding->pkts++;
+
+    return 0;
+}
+
+static void mctp_binding_gather_done(void *arg)
+{
+    struct mctp_binding_gather *binding = arg;
+
+    binding->done++;
+}
+
+static void mctp_core_test_txv()
+{
+    struct mctp                       *mctp = NULL;
+    static struct mctp_binding_gather  binding;
+    static uint8_t                     test_payload[3 * MCTP_BTU];
+    struct mctp_iov                    iov[3];
+    size_t                             i;
+    uint32_t                           ic;
+
+    for ( i = 0; i < sizeof(test_payload); i++ ) test_payload[i] = i & 0x7f;
+
+    binding.binding.name      = "gather";
+    binding.binding.version   = 1;
+    binding.binding.tx        = mctp_binding_gather_tx;
+    binding.binding.pkt_size  = MCTP_PACKET_SIZE(MCTP_BTU);
+    binding.binding.tx_gather = true;
+
+    mctp = mctp_init();
+    assert(mctp);
+    mctp_register_bus(mctp, &binding.binding, TEST_SRC_EID);
+    mctp_binding_set_tx_enabled(&binding.binding, true);
+    mctp_set_msg_ic(mctp, 0x7e, true);
+
+    /* A small header, then the payload across two entries */
+    iov[0].base = test_payload;
+    iov[0].len  = 3;
+    iov[1].base = test_payload + 3;
+    iov[1].len  = MCTP_BTU;
+    iov[2].base = test_payload + 3 + MCTP_BTU;
+    iov[2].len  = sizeof(test_payload) - 3 - MCTP_BTU;
+
+    assert(! mctp_message_txv(mctp, TEST_DEST_EID, true, 0, iov, 3, mctp_binding_gather_done, &binding));
+    assert(binding.done == 1);
+    assert(binding.pkts == 3);
+    assert(binding.ext_pkts == 3);
+    assert(binding.len == sizeof(test_payload));
+    assert(! memcmp(binding.msg, test_payload, sizeof(test_payload)));
+
+    /* Without completion the payload is copied */
+    memset(&binding.msg, 0, sizeof(binding.msg));
+    binding.len      = 0;
+    binding.pkts     = 0;
+    binding.ext_pkts = 0;
+    binding.done     = 0;
+    assert(! mctp_message_txv(mctp, TEST_DEST_EID, true, 0, iov, 3, NULL, NULL));
+    assert(binding.done == 0);
+    assert(binding.ext_pkts == 0);
+    assert(binding.len == sizeof(test_payload));
+    assert(! memcmp(binding.msg, test_payload, sizeof(test_payload)));
+
+    /* The integrity check trailer lands in a copied packet of its own */
+    test_payload[0]  = MCTP_MSG_IC_BIT | 0x7e;
+    binding.len      = 0;
+    binding.pkts     = 0;
+    binding.ext_pkts = 0;
+    binding.done     = 0;
+    assert(! mctp_message_txv(mctp, TEST_DEST_EID, true, 0, iov, 3, mctp_binding_gather_done, &binding));
+    assert(binding.done == 1);
+    assert(binding.pkts == 4);
+    assert(binding.ext_pkts == 3);
+    assert(binding.len == sizeof(test_payload) + MCTP_MSG_IC_SIZE);
+
+    ic = crc32c(test_payload, sizeof(test_payload));
+    assert(binding.msg[sizeof(test_payload)] == (ic & 0xff));
+    assert(binding.msg[sizeof(test_payload) + 3] == (ic >> 24));
+
+    mctp_destroy(mctp);
+}
+
+struct mctp_binding_batch
+{
+    struct mctp_binding binding;
+    uint8_t             msg[8 * MCTP_BTU];
+    size_t              len;
+    int                 pkts;
+    int                 batches;
+    bool                busy;
+};
+
+/* Takes up to three packets per transfer */
+static int mctp_binding_batch_tx(struct mctp_binding *b, struct mctp_pktbuf *pkts, size_t n)
+{
+    struct mctp_binding_batch *binding = container_of(b, struct mctp_binding_batch, binding);
+    size_t                     i;
+
+    if ( binding->busy )
+        return -EBUSY;
+
+    for ( i = 0; i < n && i < 3; i++, pkts = pkts->next )
+    {
+        memcpy(binding->msg + binding->len, MCTP_PKTBUF_DATA(pkts), MCTP_PKTBUF_PAYLOAD_SIZE(pkts));
+        binding->len += MCTP_PKTBUF_PAYLOAD_SIZE(pkts);
+        binding->pkts++;
+    }
+
+    binding->batches++;
+
+    return i;
+}
+
+static void mctp_core_test_tx_batch()
+{
+    struct mctp                     *mctp = NULL;
+    static struct mctp_binding_batch binding;
+    static uint8_t                   test_payload[7 * MCTP_BTU];
+    size_t                           i;
+
+    for ( i = 0; i < sizeof(test_payload); i++ ) test_payload[i] = i & 0x7f;
+
+    binding.binding.name     = "batch";
+    binding.binding.version  = 1;
+    binding.binding.tx_batch = mctp_binding_batch_tx;
+    binding.binding.pkt_size = MCTP_PACKET_SIZE(MCTP_BTU);
+
+    mctp = mctp_init();
+    assert(mctp);
+    mctp_register_bus(mctp, &binding.binding, TEST_SRC_EID);
+    mctp_binding_set_tx_enabled(&binding.binding, true);
+
+    assert(! mctp_message_tx(mctp, TEST_DEST_EID, true, 0, test_payload, sizeof(test_payload)));
+    assert(binding.pkts == 7);
+    assert(binding.batches == 3);
+    assert(binding.len == sizeof(test_payload));
+    assert(! memcmp(binding.msg, test_payload, sizeof(test_payload)));
+
+    /* A busy binding keeps the packets queued until it is enabled again */
+    binding.len     = 0;
+    binding.pkts    = 0;
+    binding.batches = 0;
+    binding.busy    = true;
+    assert(! mctp_message_tx(mctp, TEST_DEST_EID, true, 0, test_payload, sizeof(test_payload)));
+    assert(binding.pkts == 0);
+
+    binding.busy = false;
+    mctp_binding_set_tx_enabled(&binding.binding, false);
+    mctp_binding_set_tx_enabled(&binding.binding, true);
+    assert(binding.pkts == 7);
+    assert(binding.batches == 3);
+    assert(! memcmp(binding.msg, test_payload, sizeof(test_payload)));
+
+    mctp_destroy(mctp);
+}
+
+static void mctp_core_test_pool_mtu()
+{
+    struct mctp              *mctp = NULL;
+    struct mctp_binding_test *binding;
+    struct mctp_binding      *b;
+    uint8_t                   test_payload[2 * MCTP_BTU];
+
+    mctp_test_stack_init(&mctp, &binding, TEST_SRC_EID);
+    b = (struct mctp_binding *) binding;
+    assert(b->pkt_pool_size == MCTP_PACKET_SIZE(MCTP_BTU));
+
+    /* Registered again with a larger MTU, the pool is kept */
+    mctp_unregister_bus(mctp, b);
+    b->pkt_size = MCTP_PACKET_SIZE(2 * MCTP_BTU);
+    assert(! mctp_register_bus(mctp, b, TEST_SRC_EID));
+    assert(b->pkt_pool_size == MCTP_PACKET_SIZE(MCTP_BTU));
+
+    /* Packets are bounded by its items and TX stays off */
+    assert(! mctp_pktbuf_alloc(b, MCTP_PACKET_SIZE(MCTP_BTU) + 1));
+    mctp_binding_set_tx_enabled(b, true);
+    memset(test_payload, 0, sizeof(test_payload));
+    assert(mctp_message_tx(mctp, TEST_DEST_EID, true, 0, test_payload, sizeof(test_payload)) == -ENXIO);
+
+    mctp_destroy(mctp);
+    mctp_binding_test_destroy(binding);
+}
+
+static uint64_t capture_clock(void)
+{
+    static uint64_t cycles;
+
+    return ++cycles;
+}
+
+static int capture_tx(struct mctp_binding *b __unused, struct mctp_pktbuf *pkt __unused)
+{
+    return 0;
+}
+
+static void mctp_core_test_capture_ring()
+{
+    struct mctp                   *mctp    = NULL;
+    struct mctp_binding_test      *binding = NULL;
+    struct mctp_capture_rec        recs[4];
+    struct mctp_capture_ring       ring;
+    const struct mctp_capture_rec *rec;
+    struct test_params             test_param;
+    uint8_t                        test_payload[3 * MCTP_BTU];
+    struct pktbuf                  pktbuf;
+    size_t                         n;
+
+    assert(mctp_capture_ring_init(&ring, recs, 3, capture_clock) == -EINVAL);
+    assert(mctp_capture_ring_init(&ring, recs, ARRAY_SIZE(recs), capture_clock) == 0);
+
+    memset(test_payload, 0x5a, sizeof(test_payload));
+    test_param.seen         = false;
+    test_param.message_size = 0;
+    mctp_test_stack_init(&mctp, &binding, TEST_DEST_EID);
+    mctp_set_rx_all(mctp, rx_message, &test_param);
+    mctp_set_capture_ring(mctp, &ring);
+    ((struct mctp_binding *) binding)->tx = capture_tx;
+    mctp_binding_set_tx_enabled((struct mctp_binding *) binding, true);
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_DEST_EID;
+    pktbuf.hdr.src  = TEST_SRC_EID;
+
+    /* Headers and the start of the payload are kept */
+    receive_two_fragment_message(binding, test_payload, MCTP_BTU, MCTP_BTU, &pktbuf);
+    assert(test_param.seen);
+
+    n = mctp_capture_ring_peek(&ring, &rec);
+    assert(n == 2);
+    assert(rec[0].len == MCTP_PACKET_SIZE(MCTP_BTU));
+    assert(rec[0].caplen == MCTP_CAPTURE_SNAPLEN);
+    assert(rec[0].outgoing == MCTP_MESSAGE_CAPTURE_INCOMING);
+    assert(rec[0].ts < rec[1].ts);
+    assert(((struct mctp_hdr *) rec[0].data)->src == TEST_SRC_EID);
+    assert(rec[1].data[sizeof(struct mctp_hdr)] == 0x5a);
+    mctp_capture_ring_consume(&ring, 1);
+
+    /* Three packets out, one more than the ring holds */
+    assert(! mctp_message_tx(mctp, TEST_SRC_EID, true, 0, test_payload, 2 * MCTP_BTU + 1));
+    assert(ring.dropped == 0);
+    assert(! mctp_message_tx(mctp, TEST_SRC_EID, true, 0, test_payload, 1));
+    assert(ring.dropped == 1);
+
+    /* The records ready wrap, they come in two runs */
+    n = mctp_capture_ring_peek(&ring, &rec);
+    assert(n == 3 && rec == &recs[1]);
+    assert(rec[1].outgoing == MCTP_MESSAGE_CAPTURE_OUTGOING);
+    assert(((struct mctp_hdr *) rec[1].data)->dest == TEST_SRC_EID);
+    mctp_capture_ring_consume(&ring, n);
+
+    n = mctp_capture_ring_peek(&ring, &rec);
+    assert(n == 1 && rec == &recs[0]);
+    assert(rec->len == MCTP_PACKET_SIZE(1));
+    assert(rec->caplen == MCTP_PACKET_SIZE(1));
+    mctp_capture_ring_consume(&ring, n);
+
+    assert(mctp_capture_ring_peek(&ring, &rec) == 0);
+
+    mctp_binding_test_destroy(binding);
+    mctp_destroy(mctp);
+}
+
+struct mctp_binding_req
+{
+    struct mctp_binding binding;
+    uint8_t             tags; /* Tags of the requests seen on the wire */
+    int                 responses;
+    int                 timeouts;
+    uint8_t             last_tag;
+};
+
+static int mctp_binding_req_tx(struct mctp_binding *b, struct mctp_pktbuf *pkt)
+{
+    struct mctp_binding_req *binding = container_of(b, struct mctp_binding_req, binding);
+    struct mctp_hdr         *hdr     = MCTP_PKTBUF_HDR(pkt);
+
+    assert(hdr->flags_seq_tag & MCTP_HDR_FLAG_TO);
+    binding->tags |= 1 << (hdr->flags_seq_tag & MCTP_HDR_TAG_MASK);
+
+    return 0;
+}
+
+static void rx_response(mctp_eid_t eid, uint8_t msg_tag, void *data, void *msg, size_t len)
+{
+    struct mctp_binding_req *binding = data;
+
+    binding->last_tag = msg_tag;
+    if ( msg )
+    {
+        assert(eid == TEST_DEST_EID);
+        binding->responses++;
+    }
+    else
+        binding->timeouts++;
+}
+
+static void mctp_core_test_request()
+{
+    struct mctp                   *mctp = NULL;
+    static struct mctp_binding_req binding;
+    static uint8_t                 test_payload[MCTP_BTU];
+    struct test_params             params = {0};
+    struct mctp_stats              stats;
+    struct pktbuf                  pktbuf;
+    uint64_t                       now = 1000;
+    int                            i;
+
+    binding.binding.name     = "req";
+    binding.binding.version  = 1;
+    binding.binding.tx       = mctp_binding_req_tx;
+    binding.binding.pkt_size = MCTP_PACKET_SIZE(MCTP_BTU);
+
+    mctp = mctp_init();
+    assert(mctp);
+    mctp_register_bus(mctp, &binding.binding, TEST_SRC_EID);
+    mctp_binding_set_tx_enabled(&binding.binding, true);
+    mctp_set_rx_all(mctp, rx_message, &params);
+    mctp_set_now_op(mctp, test_now, &now);
+
+    /* Eight requests in flight to one EID, each with its own tag */
+    for ( i = 0; i < 8; i++ ) assert(mctp_message_request(mctp, TEST_DEST_EID, test_payload, 4, rx_response, &binding) == i);
+    assert(binding.tags == 0xff);
+    assert(mctp_message_request(mctp, TEST_DEST_EID, test_payload, 4, rx_response, &binding) == -EBUSY);
+    assert(mctp_message_tx(mctp, TEST_DEST_EID, true, 3, test_payload, 4) == -EBUSY);
+
+    /* Another EID has tags of its own */
+    assert(mctp_message_request(mctp, TEST_DEST_EID + 1, test_payload, 4, rx_response, &binding) == 0);
+
+    /* Responses are matched on source and tag, out of order */
+    memset(&pktbuf, 0, sizeof(pktbuf));
+    pktbuf.hdr.dest = TEST_SRC_EID;
+    pktbuf.hdr.src  = TEST_DEST_EID;
+    receive_one_fragment((struct mctp_binding_test *) &binding, test_payload, 4, MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | 5, &pktbuf);
+    assert(binding.responses == 1);
+    assert(binding.last_tag == 5);
+    assert(! params.seen);
+
+    /* A tag owner message with a pending tag is a new request, not a response */
+    receive_one_fragment((struct mctp_binding_test *) &binding, test_payload, 4, MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | MCTP_HDR_FLAG_TO | 2, &pktbuf);
+    assert(params.seen);
+    assert(binding.responses == 1);
+
+    /* The freed tag is handed out again */
+    assert(mctp_message_request(mctp, TEST_DEST_EID, test_payload, 4, rx_response, &binding) == 5);
+
+    /* Unanswered requests time out */
+    now += MCTP_REQ_TIMEOUT + 2 * MCTP_MSG_CTX_WHEEL_TICK;
+    assert(mctp_poll(mctp) == 9);
+    assert(binding.timeouts == 9);
+    mctp_get_stats(mctp, &stats);
+    assert(stats.req_timeouts == 9);
+
+    /* A late response goes to the RX callback */
+    params.seen = false;
+    receive_one_fragment((struct mctp_binding_test *) &binding, test_payload, 4, MCTP_HDR_FLAG_SOM | MCTP_HDR_FLAG_EOM | 5, &pktbuf);
+    assert(params.seen);
+    assert(binding.responses == 1);
+
+    mctp_destroy(mctp);
+}
+
+static void mctp_core_test_route()
+{
+    struct mctp              *mctp = NULL;
+    struct mctp_binding_test *bindings[MCTP_MAX_BUSSES + 1];
+    int                       i;
+
+    mctp = mctp_init();
+    assert(mctp);
+
+    for ( i = 0; i <= MCTP_MAX_BUSSES; i++ )
+    {
+        bindings[i] = mctp_binding_test_init();
+        assert(bindings[i]);
+    }
+
+    /* No bus, no route */
+    assert(! mctp_route_lookup(mctp, TEST_DEST_EID));
+
+    for ( i = 0; i < MCTP_MAX_BUSSES; i++ ) assert(! mctp_register_bus(mctp, (struct mctp_binding *) bindings[i], TEST_SRC_EID + i));
+    assert(mctp_register_bus(mctp, (struct mctp_binding *) bindings[MCTP_MAX_BUSSES], TEST_SRC_EID) == -ENOSPC);
+
+    /* The first bus is the default route */
+    assert(mctp_route_lookup(mctp, TEST_DEST_EID) == (struct mctp_binding *) bindings[0]);
+
+    /* A range behind a bridge, with a single EID routed elsewhere inside */
+    assert(! mctp_route_add(mctp, 0x20, 0x2f, (struct mctp_binding *) bindings[1]));
+    assert(! mctp_route_add(mctp, 0x28, 0x28, (struct mctp_binding *) bindings[2]));
+    assert(mctp_route_add(mctp, 0x2f, 0x20, (struct mctp_binding *) bindings[1]) == -EINVAL);
+
+    assert(mctp_route_lookup(mctp, 0x1f) == (struct mctp_binding *) bindings[0]);
+    assert(mctp_route_lookup(mctp, 0x20) == (struct mctp_binding *) bindings[1]);
+    assert(mctp_route_lookup(mctp, 0x28) == (struct mctp_binding *) bindings[2]);
+    assert(mctp_route_lookup(mctp, 0x2f) == (struct mctp_binding *) bindings[1]);
+    assert(mctp_route_lookup(mctp, 0x30) == (struct mctp_binding *) bindings[0]);
+
+    /* Removed routes, and routes through a removed bus, use the default */
+    assert(! mctp_route_del(mctp, 0x20, 0x27));
+    assert(mctp_route_lookup(mctp, 0x20) == (struct mctp_binding *) bindings[0]);
+    assert(mctp_route_lookup(mctp, 0x29) == (struct mctp_binding *) bindings[1]);
+
+    mctp_unregister_bus(mctp, (struct mctp_binding *) bindings[2]);
+    assert(mctp_route_lookup(mctp, 0x28) == (struct mctp_binding *) bindings[0]);
+
+    /* The freed slot can be reused */
+    assert(! mctp_register_bus(mctp, (struct mctp_binding *) bindings[MCTP_MAX_BUSSES], TEST_SRC_EID));
+
+    mctp_destroy(mctp);
+    for ( i = 0; i <= MCTP_MAX_BUSSES; i++ ) mctp_binding_test_destroy(bindings[i]);
+}
+
 /* clang-format off */
 #define TEST_CASE(test) { #test, test }
 static const struct {
@@ -562,10 +1578,24 @@ static const struct {
 	TEST_CASE(mctp_core_test_receive_bigger_end_fragment),
 	TEST_CASE(mctp_core_test_drop_large_fragments),
 	TEST_CASE(mctp_core_test_exhaust_context_buffers),
+	TEST_CASE(mctp_core_test_rx_interleaved),
+	TEST_CASE(mctp_core_test_rx_timeout),
+	TEST_CASE(mctp_core_test_rx_batch),
 	TEST_CASE(mctp_core_test_rx_with_tag),
 	TEST_CASE(mctp_core_test_rx_with_tag_multifragment),
 	TEST_CASE(mctp_core_test_rx_with_null_dst_eid),
 	TEST_CASE(mctp_core_test_rx_with_broadcast_dst_eid),
+	TEST_CASE(mctp_core_test_rx_integrity_check),
+	TEST_CASE(mctp_core_test_rx_scatter),
+	TEST_CASE(mctp_core_test_rx_buf_ops),
+	TEST_CASE(mctp_core_test_rx_stream),
+	TEST_CASE(mctp_core_test_rx_stream_stop),
+	TEST_CASE(mctp_core_test_txv),
+	TEST_CASE(mctp_core_test_tx_batch),
+	TEST_CASE(mctp_core_test_pool_mtu),
+	TEST_CASE(mctp_core_test_capture_ring),
+	TEST_CASE(mctp_core_test_request),
+	TEST_CASE(mctp_core_test_route),
 };
 /* clang-format on */
 
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crc32.h"
+#include "crc32c.h"
+#include "crc-16-ccitt.h"
+
+#define TEST_CRC_MAX_LEN 4096
+
+/* The original bit-at-a-time implementation, used as the reference */
+static uint32_t crc32_bitwise(const void *buf, size_t len)
+{
+    const uint8_t *buf8 = buf;
+    uint32_t       rem  = 0xffffffff;
+
+    for ( ; len; len-- )
+    {
+        int i;
+
+        rem = rem ^ *buf8;
+        for ( i = 0; i < CHAR_BIT; i++ ) rem = (rem >> 1) ^ ((rem & 1) * 0xEDB88320);
+
+        buf8++;
+    }
+
+    return rem ^ 0xffffffff;
+}
+
+/* Bit-at-a-time reflected CRC-16-CCITT, used as the reference */
+static uint16_t crc_16_ccitt_bitwise(uint16_t fcs, const uint8_t *cp, uint32_t len)
+{
+    int i;
+
+    for ( ; len; len-- )
+    {
+        fcs ^= *cp++;
+        for ( i = 0; i < CHAR_BIT; i++ ) fcs = (fcs >> 1) ^ ((fcs & 1) * 0x8408);
+    }
+
+    return fcs;
+}
+
+static void test_crc_16_ccitt(const uint8_t *buf)
+{
+    struct crc_16_ccitt_ctx ctx;
+    size_t                  len, off, split;
+    uint16_t                fcs;
+
+    /* CRC-16/MCRF4XX check value (no final xor, as used by serial) */
+    assert(crc_16_ccitt(FCS_INIT_16, (const uint8_t *) "123456789", 9) == 0x6F91);
+
+    for ( off = 0; off < 4; off++ )
+    {
+        for ( len = 0; len <= 1024; len++ )
+        {
+            fcs = crc_16_ccitt_bitwise(FCS_INIT_16, buf + off, len);
+            assert(crc_16_ccitt(FCS_INIT_16, buf + off, len) == fcs);
+        }
+    }
+
+    /* Streaming in arbitrary spans, including single bytes */
+    fcs = crc_16_ccitt_bitwise(FCS_INIT_16, buf, 255);
+    for ( split = 0; split <= 255; split++ )
+    {
+        crc_16_ccitt_init(&ctx);
+        crc_16_ccitt_update(&ctx, buf, split);
+        if ( split < 255 )
+        {
+            crc_16_ccitt_update_byte(&ctx, buf[split]);
+            crc_16_ccitt_update(&ctx, buf + split + 1, 255 - split - 1);
+        }
+        assert(crc_16_ccitt_final(&ctx) == fcs);
+    }
+}
+
+/* Bit-at-a-time CRC-32C, used as the reference */
+static uint32_t crc32c_bitwise(const void *buf, size_t len)
+{
+    const uint8_t *buf8 = buf;
+    uint32_t       rem  = 0xffffffff;
+    int            i;
+
+    for ( ; len; len-- )
+    {
+        rem ^= *buf8++;
+        for ( i = 0; i < CHAR_BIT; i++ ) rem = (rem >> 1) ^ ((rem & 1) * 0x82F63B78);
+    }
+
+    return rem ^ 0xffffffff;
+}
+
+static void test_crc32c(const uint8_t *buf)
+{
+    size_t len, off, split;
+
+    /* Standard check value for CRC-32/ISCSI */
+    assert(crc32c("123456789", 9) == 0xE3069283);
+
+    for ( off = 0; off < 8; off++ )
+    {
+        for ( len = 0; len <= TEST_CRC_MAX_LEN - off; len += (len < 300) ? 1 : 61 )
+            assert(crc32c(buf + off, len) == crc32c_bitwise(buf + off, len));
+    }
+
+    for ( split = 0; split <= 1500; split += 7 )
+        assert(crc32c_update(crc32c(buf, split), buf + split, 1500 - split) == crc32c_bitwise(buf, 1500));
+}
+
+static void test_crc_combine(const uint8_t *buf)
+{
+    size_t len = TEST_CRC_MAX_LEN, split;
+
+    for ( split = 0; split <= len; split += (split < 64) ? 1 : 127 )
+    {
+        assert(crc32_combine(crc32(buf, split), crc32(buf + split, len - split), len - split) == crc32(buf, len));
+        assert(crc32c_combine(crc32c(buf, split), crc32c(buf + split, len - split), len - split) == crc32c(buf, len));
+    }
+}
+
+static void test_crc32_check_value(void)
+{
+    /* Standard check value for CRC-32/ISO-HDLC */
+    assert(crc32("123456789", 9) == 0xCBF43926);
+    assert(crc32(NULL, 0) == 0);
+}
+
+static void test_crc32_lengths(const uint8_t *buf)
+{
+    size_t len, off;
+
+    /* Every length up to the maximum, from every alignment */
+    for ( off = 0; off < 8; off++ )
+    {
+        for ( len = 0; len <= TEST_CRC_MAX_LEN - off; len += (len < 300) ? 1 : 61 )
+            assert(crc32(buf + off, len) == crc32_bitwise(buf + off, len));
+    }
+}
+
+static void test_crc32_update(const uint8_t *buf)
+{
+    size_t   len = 1500, split;
+    uint32_t expected, crc;
+
+    expected = crc32_bitwise(buf, len);
+
+    for ( split = 0; split <= len; split += 7 )
+    {
+        crc = crc32_update(0, buf, split);
+        crc = crc32_update(crc, buf + split, len - split);
+        assert(crc == expected);
+    }
+}
+
+int main(void)
+{
+    uint8_t *buf;
+    size_t   i;
+
+    buf = malloc(TEST_CRC_MAX_LEN);
+    assert(buf);
+
+    srand(0x4d435450);
+    for ( i = 0; i < TEST_CRC_MAX_LEN; i++ ) buf[i] = rand();
+
+    test_crc32_check_value();
+    test_crc32_lengths(buf);
+    test_crc32_update(buf);
+    test_crc_16_ccitt(buf);
+    test_crc32c(buf);
+    test_crc_combine(buf);
+
+    free(buf);
+
+    return EXIT_SUCCESS;
+}
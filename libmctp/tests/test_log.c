@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+/* The binary log macros, with the debug level compiled out */
+#define MCTP_LOG_BINARY
+#define MCTP_LOG_LEVEL MCTP_LOG_INFO
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libmctp.h"
+#include "libmctp-log.h"
+
+#define TEST_LOG_RECORDS 8
+
+static struct mctp_log_rec recs[TEST_LOG_RECORDS];
+
+static int debug_evaluated;
+
+static int test_log_debug_arg(void)
+{
+    return ++debug_evaluated;
+}
+
+static const char *test_log_name = "usb";
+
+static void test_log_record(void)
+{
+    const struct mctp_log_rec *rec;
+
+    assert(mctp_set_log_binary(recs, TEST_LOG_RECORDS, MCTP_LOG_DEBUG) == 0);
+
+    mctp_prerr("no arguments");
+    mctp_prinfo("%s: eid %d, len %zu, %p", test_log_name, -1, (size_t) 1024, (void *) recs);
+    mctp_prdebug("compiled out %d", test_log_debug_arg());
+
+    /* Neither formatted nor, for the debug one, evaluated */
+    assert(debug_evaluated == 0);
+
+    rec = &recs[1];
+    assert(rec->seq == 1);
+    assert(rec->level == MCTP_LOG_ERR);
+    assert(rec->nargs == 0);
+    assert(strcmp(rec->fmt, "no arguments") == 0);
+
+    rec = &recs[2];
+    assert(rec->seq == 2);
+    assert(rec->level == MCTP_LOG_INFO);
+    assert(rec->nargs == 4);
+    assert(strcmp(rec->fmt, "%s: eid %d, len %zu, %p") == 0);
+    assert((const char *) rec->args[0] == test_log_name);
+    assert((int) rec->args[1] == -1);
+    assert(rec->args[2] == 1024);
+    assert(rec->args[3] == (uintptr_t) recs);
+
+    assert(recs[3].seq == 0);
+}
+
+static void test_log_threshold(void)
+{
+    /* Filtered at run time by the sink level */
+    assert(mctp_set_log_binary(recs, TEST_LOG_RECORDS, MCTP_LOG_WARNING) == 0);
+
+    mctp_prinfo("filtered");
+    mctp_prwarn("kept %d", 1);
+
+    assert(recs[1].seq == 1);
+    assert(recs[1].level == MCTP_LOG_WARNING);
+    assert(recs[2].seq == 0);
+}
+
+static void test_log_wrap(void)
+{
+    uint32_t i;
+
+    assert(mctp_set_log_binary(recs, TEST_LOG_RECORDS, MCTP_LOG_DEBUG) == 0);
+
+    /* The oldest records are overwritten */
+    for ( i = 1; i <= TEST_LOG_RECORDS + 3; i++ ) mctp_prinfo("record %u", i);
+
+    for ( i = 0; i < TEST_LOG_RECORDS; i++ )
+    {
+        assert(recs[i].seq > 3);
+        assert(recs[i].args[0] == recs[i].seq);
+    }
+}
+
+static void test_log_invalid(void)
+{
+    assert(mctp_set_log_binary(recs, TEST_LOG_RECORDS - 1, MCTP_LOG_DEBUG) == -EINVAL);
+    assert(mctp_set_log_binary(recs, 0, MCTP_LOG_DEBUG) == -EINVAL);
+}
+
+int main(void)
+{
+    test_log_record();
+    test_log_threshold();
+    test_log_wrap();
+    test_log_invalid();
+
+    return EXIT_SUCCESS;
+}
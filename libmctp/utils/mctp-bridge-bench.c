@@ -0,0 +1,270 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+/*
+ * Host benchmark for bridging a 1500 bytes message from a USB binding to
+ * the serial binding, cut-through versus store and forward. Latency is
+ * taken on a simulated timeline: the USB packets come in at the link rate
+ * and the serial line sends a frame once the previous one is out, so the
+ * numbers show when the bytes leave rather than how fast the host is. The
+ * time spent in the core per message is measured on the host clock, and
+ * memory as the peak of pool items in use, through a counting allocator.
+ *
+ * Built on the host, without the Xtensa SDK:
+ *   gcc -O2 -DHAVE_CONFIG_H -Ilibmctp -Isrc/include -o mctp-bridge-bench
+ *       libmctp/utils/mctp-bridge-bench.c libmctp/core.c libmctp/alloc.c
+ *       libmctp/log.c libmctp/crc32c.c libmctp/serial.c
+ *       libmctp/crc-16-ccitt.c src/hal/hal_msgq.c
+ */
+
+#define _GNU_SOURCE
+
+#include <err.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libmctp.h"
+#include "libmctp-alloc.h"
+#include "libmctp-serial.h"
+
+#define BENCH_MSG_SIZE    1500
+#define BENCH_ITERATIONS  2000
+#define BENCH_USB_BTU     64
+#define BENCH_USB_MBPS    12.0 /* Full speed, packets back to back */
+#define BENCH_SRC_EID     8
+#define BENCH_DEST_EID    9
+#define BENCH_MAX_POOLS   4
+#define BENCH_SERIAL_POOL (BENCH_MSG_SIZE / MCTP_BTU + 1) /* Store and forward queues the whole message at once */
+
+static const uint32_t bench_bauds[] = {115200, 3000000};
+
+/* Counting allocator over the default one */
+struct pool_stat
+{
+    uintptr_t pool;
+    size_t    item_size;
+};
+
+static struct pool_stat pools[BENCH_MAX_POOLS];
+static size_t           n_pools, in_use, peak;
+
+/* Simulated timeline, in us */
+static double now_us, line_free_us, first_byte_us;
+static double byte_us; /* Serial byte time, start and stop bits included */
+
+/* The hal heap, on the host */
+void *hal_alloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t pool_item_size(uintptr_t pool)
+{
+    size_t i;
+
+    for ( i = 0; i < n_pools; i++ )
+    {
+        if ( pools[i].pool == pool )
+            return pools[i].item_size;
+    }
+
+    return 0;
+}
+
+static void count_alloc(void *p, uintptr_t pool)
+{
+    if ( ! p )
+        return;
+
+    in_use += pool_item_size(pool);
+    if ( in_use > peak )
+        peak = in_use;
+}
+
+static uintptr_t count_pool_create(void *data, size_t item_size, size_t count)
+{
+    uintptr_t pool = mctp_default_alloc_ops.pool_create(data, item_size, count);
+
+    if ( pool && n_pools < BENCH_MAX_POOLS )
+    {
+        pools[n_pools].pool      = pool;
+        pools[n_pools].item_size = item_size;
+        n_pools++;
+    }
+
+    return pool;
+}
+
+static void *count_pkt_alloc(void *data, uintptr_t pool)
+{
+    void *p = mctp_default_alloc_ops.pkt_alloc(data, pool);
+
+    count_alloc(p, pool);
+
+    return p;
+}
+
+static void *count_ctx_alloc(void *data, uintptr_t pool)
+{
+    void *p = mctp_default_alloc_ops.ctx_alloc(data, pool);
+
+    count_alloc(p, pool);
+
+    return p;
+}
+
+static void count_free(void *data, uintptr_t pool, void *ptr)
+{
+    in_use -= pool_item_size(pool);
+    mctp_default_alloc_ops.free(data, pool, ptr);
+}
+
+static const struct mctp_alloc_ops count_alloc_ops = {
+    .pool_create = count_pool_create,
+    .pkt_alloc   = count_pkt_alloc,
+    .ctx_alloc   = count_ctx_alloc,
+    .free        = count_free,
+};
+
+/* The USB side only receives in this benchmark */
+static int usb_tx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+{
+    return 0;
+}
+
+/* The serial line: a frame starts once handed over and the line is free */
+static int serial_line_tx(void *data, void *buf, size_t len)
+{
+    double start = now_us > line_free_us ? now_us : line_free_us;
+
+    if ( first_byte_us < 0 )
+        first_byte_us = start + byte_us;
+
+    line_free_us = start + len * byte_us;
+
+    return len;
+}
+
+/* The message as the USB binding receives it */
+static void usb_rx_msg(struct mctp_binding *usb, const uint8_t *msg, double pkt_us, bool timeline)
+{
+    struct mctp_pktbuf *pkt;
+    struct mctp_hdr    *hdr;
+    size_t              off, len;
+    int                 i;
+
+    for ( off = 0, i = 0; off < BENCH_MSG_SIZE; off += len, i++ )
+    {
+        len = BENCH_MSG_SIZE - off;
+        if ( len > BENCH_USB_BTU )
+            len = BENCH_USB_BTU;
+
+        pkt = mctp_pktbuf_alloc(usb, sizeof(*hdr) + len);
+        if ( ! pkt )
+            errx(EXIT_FAILURE, "USB packet pool exhausted");
+
+        hdr                = MCTP_PKTBUF_HDR(pkt);
+        hdr->ver           = 1;
+        hdr->src           = BENCH_SRC_EID;
+        hdr->dest          = BENCH_DEST_EID;
+        hdr->flags_seq_tag = MCTP_HDR_FLAG_TO | ((i & MCTP_HDR_SEQ_MASK) << MCTP_HDR_SEQ_SHIFT);
+        if ( off == 0 )
+            hdr->flags_seq_tag |= MCTP_HDR_FLAG_SOM;
+        if ( off + len == BENCH_MSG_SIZE )
+            hdr->flags_seq_tag |= MCTP_HDR_FLAG_EOM;
+
+        memcpy(MCTP_PKTBUF_DATA(pkt), msg + off, len);
+
+        /* In by the end of its transfer */
+        if ( timeline )
+            now_us = (i + 1) * pkt_us;
+
+        mctp_bus_rx(usb, pkt);
+    }
+}
+
+static void bench_run(bool cut_through, uint32_t baud, const uint8_t *msg)
+{
+    struct mctp_binding_serial *serial;
+    struct mctp_binding         usb;
+    struct mctp                *mctp;
+    struct mctp_stats           stats;
+    double                      pkt_us, start, elapsed;
+    int                         i;
+
+    memset(&usb, 0, sizeof(usb));
+    usb.name     = "usb";
+    usb.version  = 1;
+    usb.pkt_size = MCTP_PACKET_SIZE(BENCH_USB_BTU);
+    usb.tx       = usb_tx;
+
+    n_pools = 0;
+    in_use  = 0;
+    peak    = 0;
+    byte_us = 10 * 1e6 / baud;
+    pkt_us  = MCTP_PACKET_SIZE(BENCH_USB_BTU) * 8 / BENCH_USB_MBPS;
+
+    mctp = mctp_init();
+    if ( ! mctp )
+        errx(EXIT_FAILURE, "mctp_init failed");
+
+    serial = mctp_serial_init();
+    mctp_serial_set_tx_fn(serial, serial_line_tx, NULL);
+    mctp_binding_serial_core(serial)->pkt_pool_count = BENCH_SERIAL_POOL;
+    mctp_set_alloc_ops(mctp, &count_alloc_ops, NULL);
+    mctp_set_bridge_cut_through(mctp, cut_through);
+
+    if ( mctp_bridge_busses(mctp, &usb, mctp_binding_serial_core(serial)) )
+        errx(EXIT_FAILURE, "mctp_bridge_busses failed");
+
+    mctp_binding_set_tx_enabled(&usb, true);
+
+    /* One message on the timeline */
+    now_us        = 0;
+    line_free_us  = 0;
+    first_byte_us = -1;
+    usb_rx_msg(&usb, msg, pkt_us, true);
+
+    printf("%-16s %8u baud  first byte %9.1f us  last byte %9.1f us  peak %5zu bytes", cut_through ? "cut-through" : "store/forward", baud,
+           first_byte_us, line_free_us, peak);
+
+    /* Then the host time spent bridging, the line always free */
+    start = now();
+    for ( i = 0; i < BENCH_ITERATIONS; i++ ) usb_rx_msg(&usb, msg, pkt_us, false);
+    elapsed = now() - start;
+
+    mctp_get_stats(mctp, &stats);
+    printf("  %6.2f us/msg  (%u packets cut)\n", elapsed * 1e6 / BENCH_ITERATIONS, stats.bridge_cut);
+
+    mctp_destroy(mctp);
+    mctp_serial_destroy(serial);
+}
+
+int main(void)
+{
+    static uint8_t msg[BENCH_MSG_SIZE];
+    size_t         i;
+
+    for ( i = 0; i < sizeof(msg); i++ ) msg[i] = i;
+
+    printf("%d bytes message, USB %d bytes BTU at %.0f Mbit/s to serial\n", BENCH_MSG_SIZE, BENCH_USB_BTU, BENCH_USB_MBPS);
+
+    for ( i = 0; i < sizeof(bench_bauds) / sizeof(bench_bauds[0]); i++ )
+    {
+        bench_run(false, bench_bauds[i], msg);
+        bench_run(true, bench_bauds[i], msg);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -144,3 +144,52 @@ void capture_socket(pcap_dumper_t *dumper, const void *buf, size_t len, bool out
     pcap_dump((u_char *) dumper, &hdr, (const u_char *) pktbuf);
     __mctp_free(pktbuf);
 }
+
+/*
+ * Write out the records of a capture ring, as many as are ready, and flush
+ * once. Timestamps are converted from 'clock_hz' ticks; records keep the
+ * start of the packets, their original length is reported in 'len'.
+ * Returns the number of records written.
+ */
+int capture_ring_drain(struct capture *cap, struct mctp_capture_ring *ring, uint64_t clock_hz)
+{
+    const struct mctp_capture_rec *rec;
+    struct pcap_pkthdr             hdr;
+    struct sll2_header            *sll2;
+    uint8_t                        pktbuf[sizeof(struct sll2_header) + MCTP_CAPTURE_SNAPLEN];
+    size_t                         n, i;
+    int                            total = 0;
+
+    sll2                    = (struct sll2_header *) pktbuf;
+    sll2->sll2_protocol     = htons(ETH_P_MCTP);
+    sll2->sll2_reserved_mbz = 0x0;
+    sll2->sll2_if_index     = 0x0;
+    sll2->sll2_hatype       = 0x0;
+    sll2->sll2_halen        = 0x0;
+    memset(sll2->sll2_addr, 0, SLL_ADDRLEN);
+
+    /* The ready records may wrap around the end of the ring */
+    while ( (n = mctp_capture_ring_peek(ring, &rec)) )
+    {
+        for ( i = 0; i < n; i++, rec++ )
+        {
+            sll2->sll2_pkttype = rec->outgoing ? LINUX_SLL_OUTGOING : LINUX_SLL_HOST;
+            memcpy(pktbuf + sizeof(struct sll2_header), rec->data, rec->caplen);
+
+            hdr.ts.tv_sec  = rec->ts / clock_hz;
+            hdr.ts.tv_usec = (rec->ts % clock_hz) * 1000000 / clock_hz;
+            hdr.caplen     = sizeof(struct sll2_header) + rec->caplen;
+            hdr.len        = sizeof(struct sll2_header) + rec->len;
+
+            pcap_dump((u_char *) cap->dumper, &hdr, (const u_char *) pktbuf);
+        }
+
+        mctp_capture_ring_consume(ring, n);
+        total += n;
+    }
+
+    if ( total )
+        pcap_dump_flush(cap->dumper);
+
+    return total;
+}
@@ -33,6 +33,7 @@ int  capture_prepare(struct capture *cap);
 void capture_close(struct capture *cap);
 void capture_binding(struct mctp_pktbuf *pkt, bool outgoing, void *user);
 void capture_socket(pcap_dumper_t *dumper, const void *buf, size_t len, bool outgoing, int eid);
+int  capture_ring_drain(struct capture *cap, struct mctp_capture_ring *ring, uint64_t clock_hz);
 #else
 #include <stdio.h>
 static inline int capture_init(void)
@@ -58,5 +59,10 @@ static inline void capture_binding(struct mctp_pktbuf *pkt __unused, bool outgoi
 static inline void capture_socket(pcap_dumper_t *dumper __unused, const void *buf __unused, size_t len __unused, bool outgoing __unused, int eid __unused)
 {
 }
+
+static inline int capture_ring_drain(struct capture *cap __unused, struct mctp_capture_ring *ring __unused, uint64_t clock_hz __unused)
+{
+    return 0;
+}
 #endif
 #endif
@@ -0,0 +1,169 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+/*
+ * Host benchmark for the CRC combine functions: the CRC of a 64 KB message
+ * is computed once serially and once split across worker threads, each
+ * checksumming its own span, with the partial results merged by
+ * crc32_combine() / crc32c_combine(). The workers are started once and
+ * synchronised with barriers so thread creation is not measured.
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crc32.h"
+#include "crc32c.h"
+
+#define BENCH_MSG_SIZE   (64 * 1024)
+#define BENCH_THREADS    4
+#define BENCH_ITERATIONS 2000
+
+typedef uint32_t (*crc_fn)(const void *buf, size_t len);
+typedef uint32_t (*crc_combine_fn)(uint32_t crc1, uint32_t crc2, size_t len2);
+
+struct crc_algo
+{
+    const char    *name;
+    crc_fn         crc;
+    crc_combine_fn combine;
+};
+
+struct worker
+{
+    pthread_t      thread;
+    const uint8_t *buf;
+    size_t         len;
+    uint32_t       result;
+};
+
+static const struct crc_algo algos[] = {
+    {"crc32", crc32, crc32_combine},
+    {"crc32c", crc32c, crc32c_combine},
+};
+
+static uint8_t           msg[BENCH_MSG_SIZE];
+static struct worker     workers[BENCH_THREADS];
+static pthread_barrier_t start_barrier, done_barrier;
+static crc_fn            worker_crc; /* NULL asks the workers to exit */
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker_run(void *arg)
+{
+    struct worker *w = arg;
+
+    for ( ;; )
+    {
+        pthread_barrier_wait(&start_barrier);
+        if ( ! worker_crc )
+            break;
+
+        w->result = worker_crc(w->buf, w->len);
+        pthread_barrier_wait(&done_barrier);
+    }
+
+    return NULL;
+}
+
+static void workers_start(void)
+{
+    size_t span = BENCH_MSG_SIZE / BENCH_THREADS;
+    int    i;
+
+    pthread_barrier_init(&start_barrier, NULL, BENCH_THREADS + 1);
+    pthread_barrier_init(&done_barrier, NULL, BENCH_THREADS + 1);
+
+    for ( i = 0; i < BENCH_THREADS; i++ )
+    {
+        workers[i].buf = msg + (i * span);
+        workers[i].len = (i == BENCH_THREADS - 1) ? BENCH_MSG_SIZE - (i * span) : span;
+
+        if ( pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) )
+            errx(EXIT_FAILURE, "pthread_create failed");
+    }
+}
+
+static void workers_stop(void)
+{
+    int i;
+
+    worker_crc = NULL;
+    pthread_barrier_wait(&start_barrier);
+
+    for ( i = 0; i < BENCH_THREADS; i++ ) pthread_join(workers[i].thread, NULL);
+}
+
+/* Let each worker checksum its span and merge their CRCs */
+static uint32_t crc_parallel(const struct crc_algo *algo)
+{
+    uint32_t crc;
+    int      i;
+
+    worker_crc = algo->crc;
+    pthread_barrier_wait(&start_barrier);
+    pthread_barrier_wait(&done_barrier);
+
+    crc = workers[0].result;
+    for ( i = 1; i < BENCH_THREADS; i++ ) crc = algo->combine(crc, workers[i].result, workers[i].len);
+
+    return crc;
+}
+
+int main(void)
+{
+    double   start, serial_s, parallel_s, combine_s;
+    uint32_t expected, crc = 0;
+    size_t   a;
+    int      i;
+
+    srand(0x4d435450);
+    for ( i = 0; i < BENCH_MSG_SIZE; i++ ) msg[i] = rand();
+
+    workers_start();
+
+    printf("%d KB message, %d threads, %d iterations\n", BENCH_MSG_SIZE / 1024, BENCH_THREADS, BENCH_ITERATIONS);
+
+    for ( a = 0; a < sizeof(algos) / sizeof(algos[0]); a++ )
+    {
+        const struct crc_algo *algo = &algos[a];
+
+        expected = algo->crc(msg, BENCH_MSG_SIZE);
+
+        start = now();
+        for ( i = 0; i < BENCH_ITERATIONS; i++ ) crc = algo->crc(msg, BENCH_MSG_SIZE);
+        serial_s = now() - start;
+        assert(crc == expected);
+
+        start = now();
+        for ( i = 0; i < BENCH_ITERATIONS; i++ ) crc = crc_parallel(algo);
+        parallel_s = now() - start;
+        assert(crc == expected);
+
+        /* Cost of the merge alone */
+        start = now();
+        for ( i = 0; i < BENCH_ITERATIONS; i++ ) crc = algo->combine(crc, expected, BENCH_MSG_SIZE / BENCH_THREADS);
+        combine_s = now() - start;
+
+        printf("%-7s serial %8.1f MB/s, parallel %8.1f MB/s, combine %6.1f ns\n", algo->name,
+               (double) BENCH_MSG_SIZE * BENCH_ITERATIONS / serial_s / 1e6, (double) BENCH_MSG_SIZE * BENCH_ITERATIONS / parallel_s / 1e6,
+               combine_s / BENCH_ITERATIONS * 1e9);
+    }
+
+    workers_stop();
+
+    return EXIT_SUCCESS;
+}
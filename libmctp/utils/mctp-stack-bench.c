@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */
+
+/*
+ * Host benchmark for independent stack instances: each worker thread owns a
+ * struct mctp with a loopback binding, sends itself messages and reassembles
+ * them, with no state shared with the other workers. The aggregate rate is
+ * measured for 1 to BENCH_STACKS concurrent stacks and should scale linearly
+ * with the number of cores. The stacks are built by the main thread, the
+ * workers are synchronised with barriers so thread creation is not measured.
+ *
+ * Built on the host, without the Xtensa SDK:
+ *   gcc -O2 -pthread -DHAVE_CONFIG_H -Ilibmctp -Isrc/include -o mctp-stack-bench
+ *       libmctp/utils/mctp-stack-bench.c libmctp/core.c libmctp/alloc.c
+ *       libmctp/log.c libmctp/crc32c.c src/hal/hal_msgq.c
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libmctp.h"
+
+#define BENCH_STACKS     4
+#define BENCH_MSG_SIZE   1024
+#define BENCH_ITERATIONS 20000
+#define BENCH_EID        8
+#define BENCH_POOL_COUNT (2 * (BENCH_MSG_SIZE / MCTP_BTU + 1)) /* Sent and looped back packets of a message */
+
+struct stack
+{
+    pthread_t           thread;
+    struct mctp        *mctp;
+    struct mctp_binding binding;
+    struct mctp_pktbuf *rx_head; /* Packets looped back, received once the message is sent */
+    struct mctp_pktbuf *rx_tail;
+    size_t              rx_count;
+    size_t              rx_msgs;
+    uint8_t             msg[BENCH_MSG_SIZE];
+};
+
+static struct stack      stacks[BENCH_STACKS];
+static pthread_barrier_t start_barrier, done_barrier;
+static int               active; /* Stacks running this round, 0 asks the workers to exit */
+
+/* The hal heap, on the host */
+void *hal_alloc(size_t size)
+{
+    return calloc(1, size);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Loop the packet back on the same binding, from its own pool */
+static int stack_tx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+{
+    struct stack       *s = (struct stack *) ((uint8_t *) binding - offsetof(struct stack, binding));
+    struct mctp_pktbuf *rx;
+    size_t              len = MCTP_PKTBUF_SIZE(pkt);
+
+    rx = mctp_pktbuf_alloc(binding, len);
+    if ( ! rx )
+        return -EBUSY;
+
+    memcpy(MCTP_PKTBUF_HDR(rx), MCTP_PKTBUF_HDR(pkt), len);
+
+    if ( s->rx_tail )
+        s->rx_tail->next = rx;
+    else
+        s->rx_head = rx;
+
+    s->rx_tail = rx;
+    s->rx_count++;
+
+    return 0;
+}
+
+static void stack_rx(uint8_t src_eid, bool tag_owner, uint8_t msg_tag, void *data, void *msg, size_t len)
+{
+    struct stack *s = data;
+
+    assert(len == BENCH_MSG_SIZE);
+    s->rx_msgs++;
+}
+
+static void stack_init(struct stack *s)
+{
+    s->mctp = mctp_init();
+    if ( ! s->mctp )
+        errx(EXIT_FAILURE, "mctp_init failed");
+
+    mctp_set_max_message_size(s->mctp, BENCH_MSG_SIZE);
+    mctp_set_rx_all(s->mctp, stack_rx, s);
+
+    s->binding.name           = "loopback";
+    s->binding.version        = 1;
+    s->binding.pkt_size       = MCTP_PACKET_SIZE(MCTP_BTU);
+    s->binding.pkt_pool_count = BENCH_POOL_COUNT;
+    s->binding.tx             = stack_tx;
+
+    if ( mctp_register_bus(s->mctp, &s->binding, BENCH_EID) )
+        errx(EXIT_FAILURE, "mctp_register_bus failed");
+
+    mctp_binding_set_tx_enabled(&s->binding, true);
+    memset(s->msg, 0x5a, sizeof(s->msg));
+}
+
+static void stack_run(struct stack *s)
+{
+    struct mctp_pktbuf *pkts;
+    size_t              n;
+    int                 i;
+
+    for ( i = 0; i < BENCH_ITERATIONS; i++ )
+    {
+        if ( mctp_message_tx(s->mctp, BENCH_EID, true, 0, s->msg, sizeof(s->msg)) )
+            errx(EXIT_FAILURE, "mctp_message_tx failed");
+
+        pkts        = s->rx_head;
+        n           = s->rx_count;
+        s->rx_head  = NULL;
+        s->rx_tail  = NULL;
+        s->rx_count = 0;
+
+        mctp_bus_rx_batch(&s->binding, pkts, n);
+    }
+}
+
+static void *worker_run(void *arg)
+{
+    struct stack *s = arg;
+
+    for ( ;; )
+    {
+        pthread_barrier_wait(&start_barrier);
+        if ( ! active )
+            break;
+
+        if ( s - stacks < active )
+            stack_run(s);
+
+        pthread_barrier_wait(&done_barrier);
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    double start, elapsed, base = 0;
+    size_t msgs;
+    int    i, n;
+
+    for ( i = 0; i < BENCH_STACKS; i++ ) stack_init(&stacks[i]);
+
+    pthread_barrier_init(&start_barrier, NULL, BENCH_STACKS + 1);
+    pthread_barrier_init(&done_barrier, NULL, BENCH_STACKS + 1);
+
+    for ( i = 0; i < BENCH_STACKS; i++ )
+    {
+        if ( pthread_create(&stacks[i].thread, NULL, worker_run, &stacks[i]) )
+            errx(EXIT_FAILURE, "pthread_create failed");
+    }
+
+    printf("%d bytes messages, %d iterations per stack\n", BENCH_MSG_SIZE, BENCH_ITERATIONS);
+
+    for ( n = 1; n <= BENCH_STACKS; n++ )
+    {
+        for ( i = 0; i < n; i++ ) stacks[i].rx_msgs = 0;
+
+        active = n;
+        start  = now();
+        pthread_barrier_wait(&start_barrier);
+        pthread_barrier_wait(&done_barrier);
+        elapsed = now() - start;
+
+        for ( msgs = 0, i = 0; i < n; i++ ) msgs += stacks[i].rx_msgs;
+        assert(msgs == (size_t) n * BENCH_ITERATIONS);
+
+        if ( n == 1 )
+            base = msgs / elapsed;
+
+        printf("%d stacks %10.0f msgs/s, %5.2fx\n", n, msgs / elapsed, msgs / elapsed / base);
+    }
+
+    active = 0;
+    pthread_barrier_wait(&start_barrier);
+
+    for ( i = 0; i < BENCH_STACKS; i++ )
+    {
+        pthread_join(stacks[i].thread, NULL);
+        mctp_destroy(stacks[i].mctp);
+    }
+
+    return EXIT_SUCCESS;
+}
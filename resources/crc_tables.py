@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+
+"""
+Intel Corporation © 2024
+All rights reserved.
+
+Description:
+------------
+This script generates the lookup tables used by the libmctp CRC
+implementations (CRC-16-CCITT, CRC-32 and CRC-32C) as C headers, so the
+tables never have to be pasted or edited by hand.
+
+Each header holds the tables for all the profiles selectable at compile time
+through MCTP_CRC_PROFILE (see libmctp/crc-profile.h):
+- MCTP_CRC_PROFILE_NIBBLE: a single 16 entries table, 4 bits per lookup.
+- MCTP_CRC_PROFILE_BYTE:   a single 256 entries table, 8 bits per lookup.
+- MCTP_CRC_PROFILE_SLICE:  slicing tables, 4 bytes (CRC-16) or 8 bytes
+                           (CRC-32) per iteration.
+Only the tables of the selected profile are compiled in.
+
+For CRC-32 and CRC-32C the x^(2^k) mod P table used by the combine functions
+is generated as well.
+
+Usage:
+------
+    python3 crc_tables.py <output_directory>
+
+Arguments:
+    <output_directory>  - Where to write the headers, normally 'libmctp'.
+
+"""
+
+import os
+import sys
+
+# Name, C type, hex digits, reflected polynomial, number of slicing tables
+CRC_MODELS = [
+    ("crc_16_ccitt", "uint16_t", 4, 0x8408, 4),
+    ("crc32", "uint32_t", 8, 0xEDB88320, 8),
+    ("crc32c", "uint32_t", 8, 0x82F63B78, 8),
+]
+
+VALUES_PER_LINE = 8
+
+
+def reflected_table(poly, bits, entries):
+    """Remainder of each index processed 'bits' bits at a time."""
+    table = []
+    for n in range(entries):
+        rem = n
+        for _ in range(bits):
+            rem = (rem >> 1) ^ (poly if rem & 1 else 0)
+        table.append(rem)
+    return table
+
+
+def slicing_tables(poly, width, count):
+    """Table k holds the remainder of table k - 1 advanced by one zero byte."""
+    mask = (1 << width) - 1
+    tables = [reflected_table(poly, 8, 256)]
+    for _ in range(1, count):
+        prev = tables[-1]
+        tables.append([((v >> 8) ^ tables[0][v & 0xFF]) & mask for v in prev])
+    return tables
+
+
+def multmodp(a, b, poly):
+    """Multiply two reflected 32 bits polynomials modulo P."""
+    m = 1 << 31
+    prod = 0
+    while True:
+        if a & m:
+            prod ^= b
+            if (a & (m - 1)) == 0:
+                break
+        m >>= 1
+        b = (b >> 1) ^ (poly if b & 1 else 0)
+    return prod
+
+
+def x2n_table(poly):
+    """x^(2^k) mod P for k = 0..31."""
+    table = []
+    p = 1 << 30  # x^1
+    for _ in range(32):
+        table.append(p)
+        p = multmodp(p, p, poly)
+    return table
+
+
+def format_values(values, digits, indent):
+    """Format a list of values as C initializer lines."""
+    lines = []
+    for i in range(0, len(values), VALUES_PER_LINE):
+        chunk = values[i:i + VALUES_PER_LINE]
+        lines.append(indent + ", ".join(f"0x{v:0{digits}x}" for v in chunk) + ",")
+    return "\n".join(lines)
+
+
+def generate_header(name, ctype, digits, poly, slices):
+    """Build the header text for one CRC model."""
+    guard = f"_{name.upper()}_TABLES_H"
+    tables = slicing_tables(poly, digits * 4, slices)
+    out = []
+
+    out.append("/* SPDX-License-Identifier: Apache-2.0 OR GPL-2.0-or-later */")
+    out.append("")
+    out.append("/* Generated by resources/crc_tables.py, do not edit. */")
+    out.append("")
+    out.append(f"#ifndef {guard}")
+    out.append(f"#define {guard}")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append('#include "crc-profile.h"')
+    out.append("")
+    out.append(f"#define {name.upper()}_POLY 0x{poly:0{digits}X} /* Reflected polynomial */")
+    out.append("")
+    out.append("#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_NIBBLE )")
+    out.append("")
+    out.append(f"static const {ctype} {name}_table_nibble[16] = {{")
+    out.append(format_values(reflected_table(poly, 4, 16), digits, "    "))
+    out.append("};")
+    out.append("")
+    out.append("#else")
+    out.append("")
+    out.append("#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_SLICE )")
+    out.append(f"#define {name.upper()}_SLICES {slices}")
+    out.append("#else")
+    out.append(f"#define {name.upper()}_SLICES 1")
+    out.append("#endif")
+    out.append("")
+    out.append(f"static const {ctype} {name}_table[{name.upper()}_SLICES][256] = {{")
+    for k, table in enumerate(tables):
+        if k == 1:
+            out.append("#if ( MCTP_CRC_PROFILE == MCTP_CRC_PROFILE_SLICE )")
+        out.append("    {")
+        out.append(format_values(table, digits, "        "))
+        out.append("    },")
+    out.append("#endif")
+    out.append("};")
+    out.append("")
+    out.append("#endif")
+
+    if ctype == "uint32_t":
+        out.append("")
+        out.append("/* x^(2^k) mod P, used to shift a CRC over runs of zeros */")
+        out.append(f"static const {ctype} {name}_x2n_table[32] = {{")
+        out.append(format_values(x2n_table(poly), digits, "    "))
+        out.append("};")
+
+    out.append("")
+    out.append("#endif")
+    out.append("")
+
+    return "\n".join(out)
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: python3 crc_tables.py <output_directory>")
+        sys.exit(1)
+
+    out_dir = sys.argv[1]
+
+    for name, ctype, digits, poly, slices in CRC_MODELS:
+        path = os.path.join(out_dir, f"{name.replace('_', '-')}-tables.h")
+        with open(path, "w") as f:
+            f.write(generate_header(name, ctype, digits, poly, slices))
+        print(f"Generated: {path}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+
+"""
+Intel Corporation © 2024
+All rights reserved.
+
+Description:
+------------
+This script prints the binary log of libmctp builds with MCTP_LOG_BINARY.
+There, the log macros only store the address of the format string and the
+raw arguments in a ring of `struct mctp_log_rec` (see libmctp/libmctp.h).
+The format strings, and the strings passed as `%s` arguments, are read back
+from the ELF the records were taken on.
+
+Steps:
+------
+1. Load the allocated sections of the ELF file.
+2. Split the dump into records, sized after the ELF class, and order them
+   by sequence number; slots never written, or being written, are skipped.
+3. Format each record as printf would have.
+
+Input:
+------
+- Path to the ELF file the log was recorded by.
+- Path to a raw dump of the records array, e.g. taken with xt-gdb:
+      dump binary memory log.bin p_defrag_lib->log_recs p_defrag_lib->log_recs + 64
+
+Output:
+-------
+- One line per record: sequence number, level and message.
+
+Usage:
+------
+    python mctp_log_decode.py <path_to_elf_file> <path_to_dump>
+
+Arguments:
+    <path_to_elf_file>  - The path to the ELF file that recorded the log.
+    <path_to_dump>      - The path to the raw records dump.
+
+"""
+
+import re
+import struct
+import sys
+
+MCTP_LOG_BIN_ARGS = 6
+
+LOG_LEVELS = {3: "err", 4: "warning", 5: "notice", 6: "info", 7: "debug"}
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# printf conversions: flags, width, precision, length modifier, conversion
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t|L)?([diouxXcspm%])")
+
+
+class Elf:
+    """Allocated sections of an ELF file, to read strings by address."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+
+        if data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+
+        self.word = 8 if data[4] == 2 else 4
+        self.endian = "<" if data[5] == 1 else ">"
+        self.sections = []
+
+        if self.word == 8:
+            shoff, = struct.unpack_from(self.endian + "Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", data, 0x3A)
+            shdr = "IIQQQQ"
+        else:
+            shoff, = struct.unpack_from(self.endian + "I", data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", data, 0x2E)
+            shdr = "IIIIII"
+
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(self.endian + shdr, data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        """The C string at 'addr', None when it is not in the image."""
+        for base, content in self.sections:
+            if base <= addr < base + len(content):
+                end = content.find(b"\0", addr - base)
+                return content[addr - base:end if end >= 0 else None].decode("utf-8", "replace")
+
+        return None
+
+
+def read_records(elf, dump):
+    """The records of the dump, in the order they were logged."""
+    word = "Q" if elf.word == 8 else "I"
+    rec = struct.Struct(f"{elf.endian}{word}{MCTP_LOG_BIN_ARGS}{word}IBB")
+    size = (rec.size + elf.word - 1) // elf.word * elf.word
+
+    records = []
+    for off in range(0, len(dump) - size + 1, size):
+        fields = rec.unpack_from(dump, off)
+        fmt, args, seq, level, nargs = fields[0], fields[1:1 + MCTP_LOG_BIN_ARGS], *fields[1 + MCTP_LOG_BIN_ARGS:]
+        if seq:
+            records.append((seq, level, fmt, args[:nargs]))
+
+    return sorted(records)
+
+
+def signed(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value >> (bits - 1) else value
+
+
+def format_record(elf, fmt, args):
+    """Format the arguments as printf would have, '%m' has no argument to show."""
+    template = elf.string(fmt)
+    if template is None:
+        return f"<format 0x{fmt:x} not in the ELF> " + " ".join(f"0x{a:x}" for a in args)
+
+    args = list(args)
+    bits = {"hh": 8, "h": 16, "l": elf.word * 8, "ll": 64, "z": elf.word * 8, "j": 64, "t": elf.word * 8}
+
+    def next_arg():
+        return args.pop(0) if args else 0
+
+    def convert(m):
+        flags, width, precision, length, conv = m.groups()
+        if conv == "%":
+            return "%"
+        if conv == "m":
+            return "<errno>"
+        if width == "*":
+            width = str(signed(next_arg(), 32))
+        if precision == "*":
+            precision = str(signed(next_arg(), 32))
+
+        spec = "%" + flags + (width or "") + ("." + precision if precision is not None else "")
+        value = next_arg()
+        size = bits.get(length, 32)
+
+        if conv == "s":
+            s = elf.string(value)
+            return (spec + "s") % (s if s is not None else f"<0x{value:x}>")
+        if conv == "c":
+            return (spec + "c") % chr(value & 0xFF)
+        if conv == "p":
+            return (spec + "s") % f"0x{value:x}"
+        if conv in "di":
+            return (spec + "d") % signed(value, size)
+
+        return (spec + conv.replace("u", "d")) % (value & ((1 << size) - 1))
+
+    return CONVERSION.sub(convert, template)
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f"Usage: {sys.argv[0]} <path_to_elf_file> <path_to_dump>")
+        sys.exit(1)
+
+    elf = Elf(sys.argv[1])
+    with open(sys.argv[2], "rb") as f:
+        dump = f.read()
+
+    for seq, level, fmt, args in read_records(elf, dump):
+        print(f"{seq:8} {LOG_LEVELS.get(level, str(level)):8} {format_record(elf, fmt, args)}")
+
+
+if __name__ == "__main__":
+    main()
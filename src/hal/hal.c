@@ -33,6 +33,7 @@
  */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -222,7 +223,7 @@ static uint64_t hal_get_sim_overhead_cycles(void)
 
 void inline hal_terminate_simulation(int status)
 {
-    fflush(stdout);
+    hal_console_flush();
     hal_delay_ms(100);
     exit(status); /* Standard C library exit */
 }
@@ -403,11 +404,171 @@ void *hal_zero_buf(void *dest, size_t n)
     return dest;
 }
 
+/**
+ * @brief Generates a single pattern word.
+ *
+ * Counter based xorshift: the word index is spread with the golden ratio
+ * constant and mixed with the seed, so every word of the stream can be
+ * produced independently of its predecessors.
+ *
+ * @param seed  Pattern seed.
+ * @param index Word index within the pattern stream.
+ * @return The pattern word.
+ */
+
+static inline uint32_t hal_pattern_word(uint32_t seed, size_t index)
+{
+    uint32_t x = seed ^ ((uint32_t) index * 0x9E3779B9U);
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return x;
+}
+
+/**
+ * @brief Fills a buffer with a seeded, position dependent pattern.
+ *
+ * @param p_buffer Pointer to the buffer to be filled.
+ * @param len      Number of bytes to fill.
+ * @param seed     Pattern seed.
+ * @param offset   Byte offset of 'p_buffer' within the logical pattern stream.
+ */
+
+void hal_pattern_fill(void *p_buffer, size_t len, uint32_t seed, size_t offset)
+{
+    uint8_t *p_byte = (uint8_t *) p_buffer;
+    size_t   index  = offset / sizeof(uint32_t);
+    uint32_t word;
+
+    if ( p_buffer == NULL || len == 0 )
+        return;
+
+    /* Head: bytes up to the next word boundary of the stream */
+    if ( offset % sizeof(uint32_t) )
+    {
+        size_t   skip  = offset % sizeof(uint32_t);
+        size_t   count = sizeof(uint32_t) - skip;
+        uint8_t *p_src = (uint8_t *) &word;
+
+        if ( count > len )
+            count = len;
+
+        word = hal_pattern_word(seed, index++);
+        memcpy(p_byte, p_src + skip, count);
+
+        p_byte += count;
+        len -= count;
+    }
+
+    /* Body: one word at a time */
+    if ( ((uintptr_t) p_byte & (sizeof(uint32_t) - 1)) == 0 )
+    {
+        uint32_t *p_word = (uint32_t *) p_byte;
+
+        for ( ; len >= sizeof(uint32_t); len -= sizeof(uint32_t) )
+            *p_word++ = hal_pattern_word(seed, index++);
+
+        p_byte = (uint8_t *) p_word;
+    }
+    else
+    {
+        for ( ; len >= sizeof(uint32_t); len -= sizeof(uint32_t) )
+        {
+            word = hal_pattern_word(seed, index++);
+            memcpy(p_byte, &word, sizeof(uint32_t));
+            p_byte += sizeof(uint32_t);
+        }
+    }
+
+    /* Tail */
+    if ( len > 0 )
+    {
+        word = hal_pattern_word(seed, index);
+        memcpy(p_byte, &word, len);
+    }
+}
+
+/**
+ * @brief Verifies a buffer (or a fragment of it) against the seeded pattern.
+ *
+ * Mismatches are accumulated rather than tested per word so that the loop
+ * stays branch free, the result is only checked once at the end.
+ *
+ * @param p_buffer Pointer to the buffer to be verified.
+ * @param len      Number of bytes to verify.
+ * @param seed     Pattern seed used when the buffer was filled.
+ * @param offset   Byte offset of 'p_buffer' within the logical pattern stream.
+ * @return 0 if the buffer matches the pattern, 1 otherwise.
+ */
+
+int hal_pattern_verify(const void *p_buffer, size_t len, uint32_t seed, size_t offset)
+{
+    const uint8_t *p_byte = (const uint8_t *) p_buffer;
+    size_t         index  = offset / sizeof(uint32_t);
+    uint32_t       diff   = 0;
+    uint32_t       word, data;
+
+    if ( p_buffer == NULL )
+        return 1;
+
+    /* Head: bytes up to the next word boundary of the stream */
+    if ( len > 0 && offset % sizeof(uint32_t) )
+    {
+        size_t   skip  = offset % sizeof(uint32_t);
+        size_t   count = sizeof(uint32_t) - skip;
+        uint8_t *p_exp = (uint8_t *) &word;
+
+        if ( count > len )
+            count = len;
+
+        word = hal_pattern_word(seed, index++);
+        for ( size_t i = 0; i < count; i++ )
+            diff |= p_byte[i] ^ p_exp[skip + i];
+
+        p_byte += count;
+        len -= count;
+    }
+
+    /* Body: one word at a time */
+    if ( ((uintptr_t) p_byte & (sizeof(uint32_t) - 1)) == 0 )
+    {
+        const uint32_t *p_word = (const uint32_t *) p_byte;
+
+        for ( ; len >= sizeof(uint32_t); len -= sizeof(uint32_t) )
+            diff |= *p_word++ ^ hal_pattern_word(seed, index++);
+
+        p_byte = (const uint8_t *) p_word;
+    }
+    else
+    {
+        for ( ; len >= sizeof(uint32_t); len -= sizeof(uint32_t) )
+        {
+            memcpy(&data, p_byte, sizeof(uint32_t));
+            diff |= data ^ hal_pattern_word(seed, index++);
+            p_byte += sizeof(uint32_t);
+        }
+    }
+
+    /* Tail */
+    if ( len > 0 )
+    {
+        uint8_t *p_exp = (uint8_t *) &word;
+
+        word = hal_pattern_word(seed, index);
+        for ( size_t i = 0; i < len; i++ )
+            diff |= p_byte[i] ^ p_exp[i];
+    }
+
+    return (diff != 0);
+}
+
 /**
  * @brief Paints a buffer with a pattern and a descriptor.
  *
- * This function fills the given buffer with a predefined pattern and
- * adds a pattern descriptor at the beginning of the buffer.
+ * This function fills the given buffer with the seeded word pattern and
+ * adds a pattern descriptor, holding the seed, at the beginning of the buffer.
  *
  * @param p_buffer Pointer to the buffer to be painted.
  * @param len Length of the buffer in bytes.
@@ -416,22 +577,17 @@ void *hal_zero_buf(void *dest, size_t n)
 
 int hal_paint_buffer(void *p_buffer, size_t len)
 {
+    static uint16_t seed = (uint16_t) HAL_PATTERN_SEED;
 
     if ( p_buffer == NULL || len < HAL_MIN_PATTERN_BUFFER_SIZE )
     {
         return 1; /* Error: Invalid input */
     }
 
-    /* Set up a pattern descriptor */
-    HAL_PATTERN_DESCRIPTOR descriptor = {0x01, 0x0000}; /* Example: version 1, checksum 0 */
+    /* Set up a pattern descriptor, every painted buffer gets its own seed */
+    HAL_PATTERN_DESCRIPTOR descriptor = {HAL_PATTERN_VERSION, seed++};
 
-    /* Calculate checksum (simple sum of pattern bytes as an example) */
-    uint8_t *pattern = (uint8_t *) p_buffer + HAL_PATTERN_DESCRIPTOR_SIZE;
-    for ( size_t i = 0; i < len - HAL_PATTERN_DESCRIPTOR_SIZE; ++i )
-    {
-        pattern[i] = (uint8_t) (i & 0xFF); /* Example pattern: incrementing bytes */
-        descriptor.checksum += pattern[i];
-    }
+    hal_pattern_fill((uint8_t *) p_buffer + HAL_PATTERN_DESCRIPTOR_SIZE, len - HAL_PATTERN_DESCRIPTOR_SIZE, descriptor.seed, 0);
 
     /* Copy the descriptor into the buffer */
     memcpy(p_buffer, &descriptor, HAL_PATTERN_DESCRIPTOR_SIZE);
@@ -442,8 +598,8 @@ int hal_paint_buffer(void *p_buffer, size_t len)
 /**
  * @brief Validates a buffer against a previously painted pattern.
  *
- * This function checks if the buffer contains the expected pattern
- * by comparing the checksum stored in the pattern descriptor.
+ * This function regenerates the pattern from the seed stored in the
+ * pattern descriptor and compares it with the buffer content.
  *
  * @param p_buffer Pointer to the buffer to be validated.
  * @param len Length of the buffer in bytes.
@@ -452,29 +608,21 @@ int hal_paint_buffer(void *p_buffer, size_t len)
 
 int hal_validate_paint_buffer(void *p_buffer, size_t len)
 {
+    HAL_PATTERN_DESCRIPTOR descriptor;
+
     if ( p_buffer == NULL || len < HAL_MIN_PATTERN_BUFFER_SIZE )
     {
         return 1; /* Error: Invalid input */
     }
 
     /* Retrieve the descriptor from the buffer */
-    HAL_PATTERN_DESCRIPTOR *descriptor = (HAL_PATTERN_DESCRIPTOR *) p_buffer;
-
-    /* Calculate checksum of the pattern */
-    uint16_t calculated_checksum = 0;
-    uint8_t *pattern             = (uint8_t *) p_buffer + HAL_PATTERN_DESCRIPTOR_SIZE;
-    for ( size_t i = 0; i < len - HAL_PATTERN_DESCRIPTOR_SIZE; ++i )
-    {
-        calculated_checksum += pattern[i];
-    }
-
-    /* Validate the checksum */
-    if ( calculated_checksum != descriptor->checksum )
+    memcpy(&descriptor, p_buffer, HAL_PATTERN_DESCRIPTOR_SIZE);
+    if ( descriptor.version != HAL_PATTERN_VERSION )
     {
-        return 1; /* Error: Pattern validation failed */
+        return 1; /* Error: Unknown pattern */
     }
 
-    return 0; /* Success: Pattern is valid */
+    return hal_pattern_verify((uint8_t *) p_buffer + HAL_PATTERN_DESCRIPTOR_SIZE, len - HAL_PATTERN_DESCRIPTOR_SIZE, descriptor.seed, 0);
 }
 
 /**
@@ -488,79 +636,14 @@ int hal_validate_paint_buffer(void *p_buffer, size_t len)
  * @param data Pointer to the byte array to be dumped.
  * @param size Number of bytes to be displayed from the array.
  * @param addAddress Boolean flag to include or omit the address field in the output.
+ *
+ * @note The output goes through the console layer and therefore could be
+ *       buffered (or deferred), see hal_console_flush().
  */
 
 void hal_hexdump(const void *data, size_t size, bool addAddress, const char *prefx)
 {
-    char           lineBuffer[80] = {0}; /* Buffer to hold the entire line for printing */
-    unsigned char *pAddr          = (unsigned char *) data;
-    unsigned char *pAscii, *pHex;
-    size_t         i, line_offset;
-    bool           print_line = false;
-
-    if ( data == NULL || size == 0 )
-        return;
-
-    printf("\n");
-
-    for ( i = 0; i < size; ++i )
-    {
-        /* Start a new line for every 16 bytes */
-        if ( i % 16 == 0 )
-        {
-            pAscii = ((unsigned char *) lineBuffer) + (addAddress ? 60 : 51);
-            pHex   = ((unsigned char *) lineBuffer) + (addAddress ? 9 : 0);
-            memset(lineBuffer, 0x20, sizeof(lineBuffer) - 1);
-
-            lineBuffer[addAddress ? 77 : 68] = '|';
-            lineBuffer[addAddress ? 59 : 50] = '|';
-
-            if ( addAddress )
-            {
-                /* Get the address field */
-                sprintf(lineBuffer, "%08x ", (uintptr_t) pAddr);
-            }
-
-            pAddr += 16;
-            line_offset = addAddress ? 9 : 0;
-            print_line  = false;
-        }
-
-        /* Append the hex value of the current byte to the line buffer */
-        unsigned char byte = ((unsigned char *) data)[i];
-        pHex[0]            = "0123456789ABCDEF"[byte >> 4];
-        pHex[1]            = "0123456789ABCDEF"[byte & 0x0F];
-        pHex[2]            = ' ';
-        pHex += 3;
-        line_offset += 3;
-
-        /* Store the ASCII character or a '.' if non-printable */
-        *pAscii = (byte >= ' ' && byte <= '~') ? byte : '.';
-        pAscii++;
-
-        /* Handle line endings */
-        if ( (i + 1) % 16 == 0 || i + 1 == size )
-            print_line = true;
-
-        if ( print_line )
-        {
-            lineBuffer[line_offset] = 0x20;
-
-            /* Print prefix if specified */
-            if ( prefx )
-                printf("%s", prefx);
-
-            if ( i + 1 == size )
-            {
-                /* Last line, do not print the newline character */
-                printf("%s", lineBuffer);
-            }
-            else
-            {
-                printf("%s\n", lineBuffer);
-            }
-        }
-    }
+    hal_console_hexdump(data, size, addAddress, prefx);
 }
 
 /**
@@ -0,0 +1,349 @@
+/**
+  ******************************************************************************
+  * @file    hal_console.c
+  * @author  IMCv2 Team
+  * @brief   Buffered and deferred console output.
+  *
+  * Text is formatted into a static buffer which is written to stdout using a
+  * single fwrite() once it fills up, on hal_console_flush() or on exit. In
+  * deferred mode hex dumps are not formatted at all while the test is
+  * running, the raw bytes are stored as records and converted to text only
+  * when the console is flushed.
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * @copyright
+  * @par Copyright (c) 2024 Intel Corporation.
+  * All rights reserved.
+  *
+  * This code is proprietary to Intel Corporation and may not be used, modified,
+  * or distributed without the express written permission of Intel Corporation.
+  *
+  ******************************************************************************
+  */
+
+#include <hal.h>
+#include <hal_console.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define HAL_CONSOLE_LINE_SIZE 80 /* Single hex dump line, including the terminator */
+
+/*! @brief Deferred record types */
+#define HAL_CONSOLE_REC_TEXT    0
+#define HAL_CONSOLE_REC_HEXDUMP 1
+
+/*! @brief Deferred record header, followed by 'size' bytes of data */
+typedef struct _console_record_t
+{
+    uint8_t     type;        /*!< Record type */
+    uint8_t     add_address; /*!< Hex dump: include the address field */
+    uint16_t    reserved;    /*!< Reserved */
+    uint32_t    size;        /*!< Bytes of data following the header */
+    const char *prefx;       /*!< Hex dump: lines prefix, could be NULL */
+    uintptr_t   address;     /*!< Hex dump: original address of the data */
+
+} console_record;
+
+/*! @brief The console session */
+typedef struct _console_session_t
+{
+    size_t out_len;   /*!< Bytes pending in 'out' */
+    bool   exit_hook; /*!< Flush was registered to run on exit */
+    char   out[HAL_CONSOLE_BUFFER_SIZE];
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DEFERRED )
+    size_t  records_len; /*!< Bytes used in 'records' */
+    uint8_t records[HAL_CONSOLE_DEFERRED_SIZE] __attribute__((aligned(sizeof(uintptr_t))));
+#endif
+
+} console_session;
+
+static console_session console;
+
+/**
+ * @brief Writes out the pending formatted text.
+ */
+
+static void hal_console_drain_out(void)
+{
+    if ( console.out_len > 0 )
+    {
+        fwrite(console.out, 1, console.out_len, stdout);
+        console.out_len = 0;
+    }
+}
+
+/**
+ * @brief Registers the exit flush hook on first use.
+ */
+
+static inline void hal_console_hook(void)
+{
+    if ( ! console.exit_hook )
+    {
+        console.exit_hook = true;
+        atexit(hal_console_flush);
+    }
+}
+
+/**
+ * @brief Appends raw characters to the output buffer.
+ * @param str Pointer to the characters to append.
+ * @param len Number of characters to append.
+ */
+
+static void hal_console_put(const char *str, size_t len)
+{
+    if ( console.out_len + len > sizeof(console.out) )
+    {
+        hal_console_drain_out();
+
+        /* Larger than the whole buffer, write it as is */
+        if ( len > sizeof(console.out) )
+        {
+            fwrite(str, 1, len, stdout);
+            return;
+        }
+    }
+
+    memcpy(console.out + console.out_len, str, len);
+    console.out_len += len;
+}
+
+/**
+ * @brief Formats a hex dump into the output buffer.
+ *
+ * Produces the exact same output as the original printf() based
+ * hal_hexdump(), only without going through printf() and sprintf().
+ *
+ * @param data Pointer to the byte array to be dumped.
+ * @param size Number of bytes to be displayed from the array.
+ * @param addAddress Include the address field.
+ * @param prefx Optional string to prepend to each line.
+ * @param address Address to display for the first byte.
+ */
+
+static void hal_console_format_hexdump(const uint8_t *data, size_t size, bool addAddress, const char *prefx, uintptr_t address)
+{
+    static const char hex[]    = "0123456789ABCDEF";
+    static const char hex_lc[] = "0123456789abcdef";
+    char              line[HAL_CONSOLE_LINE_SIZE];
+    size_t            prefx_len = prefx ? strlen(prefx) : 0;
+    size_t            hex_start = addAddress ? 9 : 0;
+    size_t            asc_start = addAddress ? 60 : 51;
+    size_t            i, j, count;
+
+    hal_console_put("\n", 1);
+
+    for ( i = 0; i < size; i += 16, address += 16 )
+    {
+        count = (size - i) < 16 ? (size - i) : 16;
+
+        memset(line, 0x20, sizeof(line) - 1);
+        line[addAddress ? 77 : 68] = '|';
+        line[addAddress ? 59 : 50] = '|';
+
+        if ( addAddress )
+        {
+            /* 32 bits address field, "%08x " */
+            for ( j = 0; j < 8; j++ ) line[j] = hex_lc[(address >> (28 - (j * 4))) & 0x0F];
+        }
+
+        for ( j = 0; j < count; j++ )
+        {
+            uint8_t byte = data[i + j];
+
+            line[hex_start + (j * 3)]     = hex[byte >> 4];
+            line[hex_start + (j * 3) + 1] = hex[byte & 0x0F];
+            line[asc_start + j]           = (byte >= ' ' && byte <= '~') ? byte : '.';
+        }
+
+        if ( prefx_len )
+            hal_console_put(prefx, prefx_len);
+
+        hal_console_put(line, sizeof(line) - 1);
+
+        /* Last line, do not print the newline character */
+        if ( i + count < size )
+            hal_console_put("\n", 1);
+    }
+}
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DEFERRED )
+
+/**
+ * @brief Formats all deferred records into the output buffer.
+ */
+
+static void hal_console_replay(void)
+{
+    size_t offset = 0;
+
+    while ( offset < console.records_len )
+    {
+        console_record *rec  = (console_record *) (console.records + offset);
+        uint8_t *       data = (uint8_t *) (rec + 1);
+
+        if ( rec->type == HAL_CONSOLE_REC_HEXDUMP )
+            hal_console_format_hexdump(data, rec->size, rec->add_address, rec->prefx, rec->address);
+        else
+            hal_console_put((const char *) data, rec->size);
+
+        offset += (sizeof(console_record) + rec->size + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
+    }
+
+    console.records_len = 0;
+}
+
+/**
+ * @brief Reserves a deferred record, formatting pending records if full.
+ * @param type Record type.
+ * @param size Bytes of data to be stored following the header.
+ * @retval Pointer to the record or NULL when it could never fit.
+ */
+
+static console_record *hal_console_record(uint8_t type, size_t size)
+{
+    console_record *rec;
+    size_t          rec_size = (sizeof(console_record) + size + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
+
+    if ( rec_size > sizeof(console.records) )
+        return NULL;
+
+    if ( console.records_len + rec_size > sizeof(console.records) )
+        hal_console_replay();
+
+    rec = (console_record *) (console.records + console.records_len);
+    console.records_len += rec_size;
+
+    rec->type        = type;
+    rec->add_address = 0;
+    rec->size        = (uint32_t) size;
+    rec->prefx       = NULL;
+    rec->address     = 0;
+
+    return rec;
+}
+
+#endif
+
+/**
+ * @brief Appends raw characters to the console buffer.
+ * @param str Pointer to the characters to append.
+ * @param len Number of characters to append.
+ */
+
+void hal_console_write(const char *str, size_t len)
+{
+    if ( str == NULL || len == 0 )
+        return;
+
+    hal_console_hook();
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DEFERRED )
+    /* Keep the text in order with the deferred hex dumps */
+    console_record *rec = hal_console_record(HAL_CONSOLE_REC_TEXT, len);
+    if ( rec != NULL )
+    {
+        memcpy(rec + 1, str, len);
+        return;
+    }
+
+    hal_console_replay();
+#endif
+
+    hal_console_put(str, len);
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DIRECT )
+    hal_console_drain_out();
+#endif
+}
+
+/**
+ * @brief Formats a message into the console buffer.
+ * @param fmt printf() style format string.
+ * @retval Number of characters produced, or a negative value on error.
+ */
+
+int hal_console_printf(const char *fmt, ...)
+{
+    char    text[256];
+    va_list args;
+    int     len;
+
+    va_start(args, fmt);
+    len = vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+
+    if ( len < 0 )
+        return len;
+
+    if ( (size_t) len < sizeof(text) )
+    {
+        hal_console_write(text, (size_t) len);
+        return len;
+    }
+
+    /* Too long for the local buffer, keep the order and print it directly */
+    hal_console_flush();
+
+    va_start(args, fmt);
+    len = vprintf(fmt, args);
+    va_end(args);
+
+    return len;
+}
+
+/**
+ * @brief Outputs a byte array as hex strings through the console.
+ * @param data Pointer to the byte array to be dumped.
+ * @param size Number of bytes to be displayed from the array.
+ * @param addAddress Boolean flag to include or omit the address field in the output.
+ * @param prefx Optional string to prepend to each line, could be NULL.
+ */
+
+void hal_console_hexdump(const void *data, size_t size, bool addAddress, const char *prefx)
+{
+    if ( data == NULL || size == 0 )
+        return;
+
+    hal_console_hook();
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DEFERRED )
+    /* Record the raw bytes only, formatting takes place on flush */
+    console_record *rec = hal_console_record(HAL_CONSOLE_REC_HEXDUMP, size);
+    if ( rec != NULL )
+    {
+        rec->add_address = addAddress;
+        rec->prefx       = prefx;
+        rec->address     = (uintptr_t) data;
+        memcpy(rec + 1, data, size);
+        return;
+    }
+
+    hal_console_replay();
+#endif
+
+    hal_console_format_hexdump((const uint8_t *) data, size, addAddress, prefx, (uintptr_t) data);
+
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DIRECT )
+    hal_console_drain_out();
+#endif
+}
+
+/**
+ * @brief Formats any deferred records and writes out the console buffer.
+ */
+
+void hal_console_flush(void)
+{
+#if ( HAL_CONSOLE_MODE == HAL_CONSOLE_DEFERRED )
+    hal_console_replay();
+#endif
+
+    hal_console_drain_out();
+    fflush(stdout);
+}
@@ -34,6 +34,26 @@ static uint16_t ncsi_htons(uint16_t hostshort)
     return (hostshort << 8) | (hostshort >> 8);
 }
 
+/* Same as ncsi_htons(), usable in static initializers */
+#define NCSI_HTONS_CONST(x) ((uint16_t) ((((x) << 8) | ((x) >> 8)) & 0xFFFF))
+
+/* Ethernet header template */
+static const ethernet_header ncsi_eth_header_template __attribute__((aligned(4))) = {
+    .dest_mac  = {0x00, 0x25, 0x90, 0xAB, 0xCD, 0xEF},
+    .src_mac   = {0x00, 0x14, 0x22, 0x01, 0x23, 0x45},
+    .ethertype = NCSI_HTONS_CONST(0x88F8), /* NC-SI EtherType */
+};
+
+/* NC-SI command/response header template, 'payload_length' is set per packet */
+static const ncsi_packet ncsi_header_template __attribute__((aligned(4))) = {
+    .mc_id          = 0xA5, /* Example MC ID */
+    .command        = 0x01, /* Select Package Command */
+    .channel_id     = 0x02, /* Channel ID */
+    .reserved       = 0x03, /* Reserved */
+    .payload_length = 0x00, /* Payload length */
+    .reserved2      = 0x5A, /* Reserved*/
+};
+
 /**
  * @brief Requests and returns a pointer to a global NC-SI Ethernet packet.
  *
@@ -62,27 +82,17 @@ ncsi_eth_packet *ncsi_request_packet(size_t *packet_size)
     if ( p_ncsi == NULL )
         return NULL;
 
-    /* Populate the Ethernet header with realistic data */
-    uint8_t example_dest_mac[6] = {0x00, 0x25, 0x90, 0xAB, 0xCD, 0xEF};
-    uint8_t example_src_mac[6]  = {0x00, 0x14, 0x22, 0x01, 0x23, 0x45};
-
-    memcpy(p_ncsi->eth_header.dest_mac, example_dest_mac, 6);
-    memcpy(p_ncsi->eth_header.src_mac, example_src_mac, 6);
-    p_ncsi->eth_header.ethertype = ncsi_htons(0x88F8); /* NC-SI EtherType */
-
-    /* Populate NC-SI command/response header with realistic data */
-    p_ncsi->ncsi_data.mc_id          = 0xA5;                     /* Example MC ID */
-    p_ncsi->ncsi_data.command        = 0x01;                     /*  Select Package Command */
-    p_ncsi->ncsi_data.channel_id     = 0x02;                     /* Channel ID */
-    p_ncsi->ncsi_data.reserved       = 0x03;                     /* Reserved */
+    /* Populate the Ethernet and NC-SI command/response headers with realistic
+       data: both are fixed templates so copy them using constant size moves
+       (the Ethernet header is 4 bytes aligned, the NC-SI one only 2) */
+    HAL_COPY_CONST_ALIGNED(&p_ncsi->eth_header, &ncsi_eth_header_template, 14, 4);
+    HAL_COPY_CONST_ALIGNED(&p_ncsi->ncsi_data, &ncsi_header_template, 8, 2);
     p_ncsi->ncsi_data.payload_length = ncsi_htons(payload_size); /* Payload length */
-    p_ncsi->ncsi_data.reserved2      = 0x5A;                     /* Reserved*/
 
 #if ( HAL_PAINT_PACKET > 0 )
-    /* Populate payload with example data, this data could be later validated */
-    int ret = hal_paint_buffer(p_ncsi->ncsi_data.payload, payload_size);
-    if ( ret != 0 )
-        return NULL;
+    /* Populate payload with the seeded pattern, it could be later validated
+       (as a whole or fragment by fragment) using hal_pattern_verify() */
+    hal_pattern_fill(p_ncsi->ncsi_data.payload, payload_size, HAL_PATTERN_SEED, 0);
 #endif
 
     *packet_size = total_size;
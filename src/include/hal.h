@@ -20,10 +20,14 @@
 #ifndef _HAL_LX7_H
 #define _HAL_LX7_H
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
+
+/* Host builds (libmctp tests and benchmarks) only get the portable part */
+#ifdef __XTENSA__
 #include <xtensa/config/core.h>
 #include <xtensa/xos_errors.h>
 #include <xtensa/xtbsp.h>
@@ -32,6 +36,7 @@
 #include <xtensa/xtbsp.h>
 #include <xtensa/xtruntime.h>
 #include <xtensa/sim.h>
+#endif
 
 /* Exported macro ------------------------------------------------------------*/
 /** @defgroup HAL_Base_Exported_Macro HAL_Base Exported Macro
@@ -103,7 +108,15 @@
     0 /**< Enable sanity checks when requesting
                                                      and releasing messages */
 
-#define HAL_PTR_SANITY_CHECKS 1 /**< Enable generic pointers checks */
+#define HAL_CONSOLE_MODE \
+    1 /**< Console output mode, see HAL_CONSOLE_xxx
+                                                     in hal_console.h */
+#define HAL_CONSOLE_BUFFER_SIZE   (16 * 1024) /**< Console output buffer size in bytes */
+#define HAL_CONSOLE_DEFERRED_SIZE (32 * 1024) /**< Deferred console records storage in bytes */
+
+#define HAL_PTR_SANITY_CHECKS 1            /**< Enable generic pointers checks */
+#define HAL_PAINT_PACKET      1            /**< Fill NC-SI payloads with the seeded pattern */
+#define HAL_PATTERN_SEED      (0x4D435450) /**< Default pattern seed ('MCTP') */
 
 /******************************************************************************
   * 
@@ -171,16 +184,76 @@
   * @}
   */
 
+/**
+ * @brief Compile-time constant size copies.
+ *
+ * HAL_COPY_CONST(dst, src, N) expands (by token pasting N) to a dedicated
+ * routine made of the minimal sequence of 32/16-bit moves for that size,
+ * rather than a generic memcpy() call or field by field stores. Supported
+ * sizes are 2, 4, 6, 8, 12, 14 and 16 bytes, any other size fails to build.
+ *
+ * HAL_COPY_CONST makes no assumption about alignment. When both pointers are
+ * known to be aligned to 'A' (2 or 4) bytes, HAL_COPY_CONST_ALIGNED lets
+ * the compiler use native loads and stores of that width.
+ */
+
+#define HAL_COPY_CONST(dst, src, N)            hal_copy_const_##N((void *) (dst), (const void *) (src), 1)
+#define HAL_COPY_CONST_ALIGNED(dst, src, N, A) hal_copy_const_##N((void *) (dst), (const void *) (src), (A))
+
+typedef uint16_t __attribute__((may_alias, aligned(1))) hal_u16_una; /**< Unaligned 16-bit access */
+typedef uint32_t __attribute__((may_alias, aligned(1))) hal_u32_una; /**< Unaligned 32-bit access */
+typedef uint16_t __attribute__((may_alias, aligned(2))) hal_u16_a2;  /**< 16-bit aligned access */
+typedef uint32_t __attribute__((may_alias, aligned(4))) hal_u32_a4;  /**< 32-bit aligned access */
+
+#define HAL_CC_MOVE(T, d, s, off) (*(T *) ((uint8_t *) (d) + (off)) = *(const T *) ((const uint8_t *) (s) + (off)))
+
+static inline __attribute__((always_inline)) void hal_copy_const_move16(void *d, const void *s, size_t off, size_t a)
+{
+    if ( a >= 2 )
+        HAL_CC_MOVE(hal_u16_a2, d, s, off);
+    else
+        HAL_CC_MOVE(hal_u16_una, d, s, off);
+}
+
+static inline __attribute__((always_inline)) void hal_copy_const_move32(void *d, const void *s, size_t off, size_t a)
+{
+    if ( a >= 4 )
+    {
+        HAL_CC_MOVE(hal_u32_a4, d, s, off);
+    }
+    else if ( a >= 2 )
+    {
+        HAL_CC_MOVE(hal_u16_a2, d, s, off);
+        HAL_CC_MOVE(hal_u16_a2, d, s, off + 2);
+    }
+    else
+    {
+        HAL_CC_MOVE(hal_u32_una, d, s, off);
+    }
+}
+
+/* clang-format off */
+static inline __attribute__((always_inline)) void hal_copy_const_2(void *d, const void *s, size_t a)  { hal_copy_const_move16(d, s, 0, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_4(void *d, const void *s, size_t a)  { hal_copy_const_move32(d, s, 0, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_6(void *d, const void *s, size_t a)  { hal_copy_const_move32(d, s, 0, a); hal_copy_const_move16(d, s, 4, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_8(void *d, const void *s, size_t a)  { hal_copy_const_move32(d, s, 0, a); hal_copy_const_move32(d, s, 4, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_12(void *d, const void *s, size_t a) { hal_copy_const_8(d, s, a); hal_copy_const_move32(d, s, 8, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_14(void *d, const void *s, size_t a) { hal_copy_const_12(d, s, a); hal_copy_const_move16(d, s, 12, a); }
+static inline __attribute__((always_inline)) void hal_copy_const_16(void *d, const void *s, size_t a) { hal_copy_const_12(d, s, a); hal_copy_const_move32(d, s, 12, a); }
+/* clang-format on */
+
 /**
  * @brief Pattern descriptor used for buffer painting and validation.
  */
 typedef struct
 {
-    uint8_t  version;  /**< Version number of the pattern descriptor. */
-    uint16_t checksum; /**< Checksum of the pattern data. */
+    uint8_t  version; /**< Version number of the pattern descriptor. */
+    uint16_t seed;    /**< Seed used to generate the pattern data. */
 
 } HAL_PATTERN_DESCRIPTOR;
 
+#define HAL_PATTERN_VERSION 0x02 /**< Seeded word-wise pattern */
+
 #define HAL_PATTERN_DESCRIPTOR_SIZE sizeof(HAL_PATTERN_DESCRIPTOR)
 #define HAL_MIN_PATTERN_BUFFER_SIZE (HAL_PATTERN_DESCRIPTOR_SIZE + 32)
 
@@ -343,6 +416,38 @@ uint64_t hal_measure_cycles(hal_sim_func func, uintptr_t arg);
 int hal_paint_buffer(void *p_buffer, size_t len);
 int hal_validate_paint_buffer(void *p_buffer, size_t len);
 
+/**
+ * @brief Fills a buffer with a seeded, position dependent pattern.
+ *
+ * The pattern is a stream of 32-bit xorshift words where each word is derived
+ * from the seed and from its index in the stream, so any slice of the stream
+ * can be generated (or verified) on its own. The buffer is processed a word
+ * at a time, only the unaligned head and tail bytes are handled one by one.
+ *
+ * @param p_buffer Pointer to the buffer to be filled.
+ * @param len      Number of bytes to fill.
+ * @param seed     Pattern seed.
+ * @param offset   Byte offset of 'p_buffer' within the logical pattern stream.
+ */
+
+void hal_pattern_fill(void *p_buffer, size_t len, uint32_t seed, size_t offset);
+
+/**
+ * @brief Verifies a buffer (or a fragment of it) against the seeded pattern.
+ *
+ * Since the pattern depends on the stream position, swapped, duplicated or
+ * shifted fragments are detected as well as corrupted bytes. Fragments can
+ * be verified one at a time by passing their offset within the stream.
+ *
+ * @param p_buffer Pointer to the buffer to be verified.
+ * @param len      Number of bytes to verify.
+ * @param seed     Pattern seed used when the buffer was filled.
+ * @param offset   Byte offset of 'p_buffer' within the logical pattern stream.
+ * @return 0 if the buffer matches the pattern, 1 otherwise.
+ */
+
+int hal_pattern_verify(const void *p_buffer, size_t len, uint32_t seed, size_t offset);
+
 /**
  * @brief Retrieve the current system tick count.
  *
@@ -393,7 +498,9 @@ int hal_get_argcv(int *argc, char ***argv);
  * @return non return call.
  */
 
+#ifdef __XTENSA__
 void hal_sys_init(XosThreadFunc startThread, int _argc, char **argv);
+#endif
 
 /**
   * @}
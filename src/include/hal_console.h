@@ -0,0 +1,81 @@
+
+/**
+  ******************************************************************************
+  * @file    hal_console.h
+  * @author  IMCv2 Team
+  * @brief   Buffered and deferred console output.
+  *
+  * Console output under the ISS is expensive: every printf() ends up as a
+  * simulated system call. This module formats text into a large static
+  * buffer which is written out in big chunks, and optionally defers hex
+  * dumps altogether by recording the raw bytes and formatting them only
+  * when the console is flushed (at the latest on exit).
+  *
+  ******************************************************************************
+  * @attention
+  *
+  * @copyright
+  * @par Copyright (c) 2024 Intel Corporation.
+  * All rights reserved.
+  *
+  * This code is proprietary to Intel Corporation and may not be used, modified,
+  * or distributed without the express written permission of Intel Corporation.
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+
+#ifndef _HAL_CONSOLE_H
+#define _HAL_CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Console modes, selected using 'HAL_CONSOLE_MODE' in hal.h */
+#define HAL_CONSOLE_DIRECT   0 /**< Output is written out on every call */
+#define HAL_CONSOLE_BUFFERED 1 /**< Output is formatted into a buffer, written out when full */
+#define HAL_CONSOLE_DEFERRED 2 /**< As buffered, hex dumps are recorded raw and formatted on flush */
+
+/**
+ * @brief Formats a message into the console buffer.
+ * @param fmt printf() style format string.
+ * @retval Number of characters produced, or a negative value on error.
+ */
+
+int hal_console_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Appends raw characters to the console buffer.
+ * @param str Pointer to the characters to append.
+ * @param len Number of characters to append.
+ */
+
+void hal_console_write(const char *str, size_t len);
+
+/**
+ * @brief Outputs a byte array as hex strings through the console.
+ *
+ * Same output format as hal_hexdump(). In deferred mode only the raw bytes
+ * are copied, the prefix string is kept by reference and must therefore
+ * remain valid until the console is flushed.
+ *
+ * @param data Pointer to the byte array to be dumped.
+ * @param size Number of bytes to be displayed from the array.
+ * @param addAddress Boolean flag to include or omit the address field in the output.
+ * @param prefx Optional string to prepend to each line, could be NULL.
+ */
+
+void hal_console_hexdump(const void *data, size_t size, bool addAddress, const char *prefx);
+
+/**
+ * @brief Formats any deferred records and writes out the console buffer.
+ *
+ * Must be called before writing to stdout directly in order to maintain
+ * the output order. Called automatically on exit.
+ */
+
+void hal_console_flush(void);
+
+#endif /* _HAL_CONSOLE_H */
@@ -30,10 +30,19 @@
   * @{
   */
 
-#define MCTP_USB_MSGQ_MAX_FRAME_SIZE     100  /**< Maximum size in bytes for each allocated buffer in the message queue */
-#define MCTP_USB_MSGQ_ALLOCATED_FRAMES   25   /**< Total number of allocated frames in the message queue */
-#define MCTP_USB_MAX_CONTEXT_SIZE        1600 /**< Used by context buffer, equal to max Ethernet frame */
-#define MCTP_USB_MSGQ_ALLOCATED_CONTEXTS 1    /**< Count of context buffers */
+#define MCTP_USB_MSGQ_MAX_FRAME_SIZE     120  /**< Maximum size in bytes for each allocated buffer in the message queue, struct mctp_pktbuf included */
+#define MCTP_USB_MSGQ_ALLOCATED_FRAMES   25   /**< Total number of frames in the packet pool of the USB binding */
+#define MCTP_USB_ROUTE_POOL_FRAMES       2    /**< Frames in the packet pool of each routing test bus */
+#define MCTP_USB_MAX_CONTEXT_SIZE        MCTP_MSG_CTX_BUF_SIZE /**< Reassembly buffer we provide libmctp with, as large as its own */
+#define MCTP_USB_INTERLEAVED_MSG_SIZE    1500 /**< Message size used by the interleaved senders test */
+#define MCTP_USB_TX_MSG_SIZE             1500 /**< Message size used by the TX test */
+#define MCTP_USB_TX_MAX_BYTES            512  /**< Bytes a single USB transfer carries */
+#define MCTP_USB_TX_MAX_POINTERS         16   /**< Pointers a single USB transfer takes */
+#define MCTP_USB_REQ_COUNT               64   /**< Requests sent by the request test */
+#define MCTP_USB_REQ_SIZE                16   /**< Size of a request, about a PLDM or NC-SI command */
+#define MCTP_USB_CAPTURE_RECORDS         32   /**< Capture ring records, a power of two above the packets of a run */
+#define MCTP_USB_LOG_RECORDS             64   /**< Binary log records kept in MCTP_LOG_BINARY debug builds, a power of two */
+#define MCTP_USB_RX_BUF_OFFSET           1    /**< Message offset in the buffer we provide libmctp with */
 #define MCTP_USB_SRC_EID                 9    /**< Dummy local end-point ID used by our test */
 #define MCTP_USB_DST_EID                 10   /**< Dummy remote end-point ID used by our test */
 
@@ -61,13 +70,6 @@ int   test_defrag_init(uintptr_t arg);
   * @{
   */
 
-/**
- * @brief Retrieves the handle to the message queue initialized by this module.
- * @return The message queue handle, or 0 if the module or message queue is not 
- *         initialized.
- */
-uintptr_t test_defrag_mctplib_get_handle(size_t type);
-
 /**
  * @brief Executes the defragmentation test using libmctp.
  * This function simulates the reception of a sequence of fragmented packets,
@@ -78,6 +80,58 @@ uintptr_t test_defrag_mctplib_get_handle(size_t type);
 int   test_defrag_mctplib_prologue(uintptr_t arg);
 void  test_exec_defrag_mctplib(uintptr_t arg);
 char *test_defrag_mctplib_desc(size_t description_type);
+char *test_defrag_mctplib_scatter_desc(size_t description_type);
+char *test_defrag_mctplib_batch_desc(size_t description_type);
+char *test_defrag_mctplib_rx_buf_desc(size_t description_type);
+char *test_defrag_mctplib_capture_desc(size_t description_type);
+int   test_defrag_mctplib_capture_epilog(uintptr_t arg);
+char *test_defrag_mctplib_stream_desc(size_t description_type);
+int   test_defrag_mctplib_stream_epilog(uintptr_t arg);
+
+/**
+ * @brief Interleaved senders variant: up to MCTP_MSG_CTX_COUNT source EIDs 
+ * (prologue argument) send 1500 bytes messages fragment by fragment in turns.
+ */
+int   test_defrag_mctplib_interleaved_prologue(uintptr_t arg);
+void  test_exec_defrag_mctplib_interleaved(uintptr_t arg);
+int   test_defrag_mctplib_interleaved_epilog(uintptr_t arg);
+char *test_defrag_mctplib_interleaved_desc(size_t description_type);
+
+/**
+ * @brief TX variant: a message is fragmented by libmctp and sent over the USB binding,
+ * a packet per transfer or in batches.
+ */
+int   test_defrag_mctplib_tx_prologue(uintptr_t arg);
+void  test_exec_defrag_mctplib_tx(uintptr_t arg);
+int   test_defrag_mctplib_tx_epilog(uintptr_t arg);
+char *test_defrag_mctplib_tx_desc(size_t description_type);
+
+/**
+ * @brief Timeout variant: messages whose EOM is lost are reclaimed once the
+ * reassembly timeout elapsed.
+ */
+int   test_defrag_mctplib_timeout_prologue(uintptr_t arg);
+void  test_exec_defrag_mctplib_timeout(uintptr_t arg);
+int   test_defrag_mctplib_timeout_epilog(uintptr_t arg);
+char *test_defrag_mctplib_timeout_desc(size_t description_type);
+
+/**
+ * @brief Request variant: requests to the remote EID are pipelined up to the
+ * prologue argument (1 to 8), the responses being matched by libmctp.
+ */
+int   test_defrag_mctplib_req_prologue(uintptr_t arg);
+void  test_exec_defrag_mctplib_req(uintptr_t arg);
+int   test_defrag_mctplib_req_epilog(uintptr_t arg);
+char *test_defrag_mctplib_req_desc(size_t description_type);
+
+/**
+ * @brief Routing variant: resolves the bus of all 256 EIDs, the USB bus being
+ * the default route and extra busses serving EID ranges.
+ */
+int   test_mctplib_route_prologue(uintptr_t arg);
+void  test_exec_mctplib_route(uintptr_t arg);
+int   test_mctplib_route_epilog(uintptr_t arg);
+char *test_mctplib_route_desc(size_t description_type);
 
 /**
  * @brief Initializes the MCTP fragmentation test environment over USB using libmctp.
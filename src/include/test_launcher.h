@@ -26,7 +26,7 @@
 #include <stdint.h>
 
 /* Maximum number of test items */
-#define TEST_LAUNCHER_MAX_ITEMS 20
+#define TEST_LAUNCHER_MAX_ITEMS 23
 
 typedef int (*test_launcher_func)(uintptr_t);
 typedef char *(*test_launcher_get_description)(size_t description_type);
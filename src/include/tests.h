@@ -39,6 +39,15 @@ void  test_exec_memcpy(uintptr_t use_hal);
 char *test_memcpy_desc_xtensa(size_t description_type);
 char *test_memcpy_desc_hal(size_t description_type);
 
+/**
+ * @brief Measures the protocol headers copy sites using HAL_COPY_CONST(), the
+ *        epilogue reports the cycles delta against the original code per site.
+ */
+
+void  test_exec_copy_const(uintptr_t arg);
+int   test_copy_const_epilog(uintptr_t arg);
+char *test_copy_const_desc(size_t description_type);
+
 /**
  * @brief Measures the number of cycles spent when requesting and releasing buffers
  *        from the message queue using `hal_measure_cycles()`.
@@ -52,6 +61,18 @@ int   test_msgq_prologue(uintptr_t arg);
 void  test_exec_msgq(uintptr_t msgq_handle);
 char *test_msgq_desc(size_t description_type);
 
+/**
+ * @brief CRC throughput, the argument selects the algorithm. The epilogue
+ *        sweeps 64 to 4096 bytes buffers and reports bytes per cycle.
+ */
+
+int   test_crc_prologue(uintptr_t arg);
+void  test_exec_crc(uintptr_t arg);
+int   test_crc_epilog(uintptr_t arg);
+char *test_crc32_desc(size_t description_type);
+char *test_crc16_desc(size_t description_type);
+char *test_crc32c_desc(size_t description_type);
+
 /**
  * @brief Provides a description for the 'useless function' test.
  * @return A pointer to a string containing the description.
@@ -19,6 +19,7 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <ncsi.h>
 #include <test_launcher.h>
 #include <tests.h>
@@ -49,7 +50,23 @@ static test_launcher_item_info tests_info[] = {
 /* 3 */ { NULL,                     test_msgq_prologue,             test_exec_msgq,             NULL,               test_msgq_desc,             0,     0,       0,  0,  1    },
 /* 4 */ { test_defrag_init,         test_defrag_prologue,           test_exec_defrag,           test_defrag_epilog, test_defrag_desc,           0,     1500,    0,  0,  1    },
 /* 5 */ { test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   NULL,               test_defrag_mctplib_desc,   0,     0,       0,  0,  1    },
-/* 6 */ { test_frag_init,           test_frag_prologue,             test_exec_frag,             test_frag_epilog,   test_frag_desc,             0,     1500,    0,  0,  1    }
+/* 6 */ { test_frag_init,           test_frag_prologue,             test_exec_frag,             test_frag_epilog,   test_frag_desc,             0,     1500,    0,  0,  1    },
+/* 7 */ { NULL,                     NULL,                           test_exec_copy_const,       test_copy_const_epilog, test_copy_const_desc,   0,     0,       0,  0,  1    },
+/* 8 */ { NULL,                     test_crc_prologue,              test_exec_crc,              test_crc_epilog,    test_crc32_desc,            0,     0,       0,  0,  1    },
+/* 9 */ { NULL,                     test_crc_prologue,              test_exec_crc,              test_crc_epilog,    test_crc16_desc,            0,     1,       1,  1,  1    },
+/* 10 */{ NULL,                     test_crc_prologue,              test_exec_crc,              test_crc_epilog,    test_crc32c_desc,           0,     2,       2,  2,  1    },
+/* 11 */{ test_defrag_mctplib_init, test_defrag_mctplib_interleaved_prologue, test_exec_defrag_mctplib_interleaved, test_defrag_mctplib_interleaved_epilog, test_defrag_mctplib_interleaved_desc, 0, 8, 0, 0, 1 },
+/* 12 */{ test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   NULL,               test_defrag_mctplib_scatter_desc, 0, 1,       0,  0,  1    },
+/* 13 */{ test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   NULL,               test_defrag_mctplib_rx_buf_desc, 0,  2,       0,  0,  1    },
+/* 14 */{ test_defrag_mctplib_init, test_mctplib_route_prologue,    test_exec_mctplib_route,    test_mctplib_route_epilog, test_mctplib_route_desc, 0, 0,   0,  0,  1    },
+/* 15 */{ test_defrag_mctplib_init, test_defrag_mctplib_timeout_prologue, test_exec_defrag_mctplib_timeout, test_defrag_mctplib_timeout_epilog, test_defrag_mctplib_timeout_desc, 0, 8, 0, 0, 1 },
+/* 16 */{ test_defrag_mctplib_init, test_defrag_mctplib_tx_prologue, test_exec_defrag_mctplib_tx, test_defrag_mctplib_tx_epilog, test_defrag_mctplib_tx_desc, 0, 0, 0, 0, 1 },
+/* 17 */{ test_defrag_mctplib_init, test_defrag_mctplib_tx_prologue, test_exec_defrag_mctplib_tx, test_defrag_mctplib_tx_epilog, test_defrag_mctplib_tx_desc, 0, 1, 0, 0, 1 },
+/* 18 */{ test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   NULL,               test_defrag_mctplib_batch_desc, 0,   0,       1,  0,  1    },
+/* 19 */{ test_defrag_mctplib_init, test_defrag_mctplib_req_prologue, test_exec_defrag_mctplib_req, test_defrag_mctplib_req_epilog, test_defrag_mctplib_req_desc, 0, 1, 0, 0, 1 },
+/* 20 */{ test_defrag_mctplib_init, test_defrag_mctplib_req_prologue, test_exec_defrag_mctplib_req, test_defrag_mctplib_req_epilog, test_defrag_mctplib_req_desc, 0, 8, 0, 0, 1 },
+/* 21 */{ test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   test_defrag_mctplib_capture_epilog, test_defrag_mctplib_capture_desc, 0, 3, 0, 0, 1 },
+/* 22 */{ test_defrag_mctplib_init, test_defrag_mctplib_prologue,   test_exec_defrag_mctplib,   test_defrag_mctplib_stream_epilog, test_defrag_mctplib_stream_desc, 0, 4, 0, 0, 1 }
 
 };
 /* clang-format on */
@@ -240,7 +257,11 @@ static int init_thread(void *arg, int32_t unused)
                 test_launcher_init(cgi_mode);
 
                 /* Now initilize the tets launcher module*/
-                init_register_tests();
+                if ( init_register_tests() == 0 )
+                {
+                    cgi_set_color(cgi_mode, "red");
+                    printf("Error: could not register the %d tests, see TEST_LAUNCHER_MAX_ITEMS.\n", (int) ARRAY_SIZE(tests_info));
+                }
 
 #if ( TEST_CONTINUOUS_MODE > 0 )
                 exec_multi_size(test_index, 24, 1500);
@@ -249,6 +270,7 @@ static int init_thread(void *arg, int32_t unused)
                 uint64_t measured_cycles = 0;    /* Cycles related to any of our tests */
 
                 measured_cycles = test_launcher_execute(test_index);
+                hal_console_flush(); /* Anything the test has buffered goes first */
 
                 if ( measured_cycles > 0 )
                 {
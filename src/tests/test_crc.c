@@ -0,0 +1,196 @@
+
+/**
+  ******************************************************************************
+  * @file    test_crc.c
+  * @author  IMCv2 Team
+  * @brief   Measure the throughput of the libmctp CRC implementations.
+  *
+  ******************************************************************************
+  *
+  * @copyright
+  * @par Copyright (c) 2024 Intel Corporation.
+  * All rights reserved.
+  *
+  * This code is proprietary to Intel Corporation and may not be used, modified,
+  * or distributed without the express written permission of Intel Corporation.
+  *
+  ******************************************************************************
+  */
+
+#include <hal.h>
+#include <hal_console.h>
+#include <tests.h>
+#include <crc32.h>
+#include <crc32c.h>
+#include <crc-16-ccitt.h>
+#include <crc-profile.h>
+
+#define TEST_CRC_MIN_SIZE  64   /* Smallest buffer in the sweep */
+#define TEST_CRC_MAX_SIZE  4096 /* Largest buffer in the sweep */
+#define TEST_CRC_EXEC_SIZE 1024 /* Buffer size used by the measured function */
+
+typedef uint32_t (*test_crc_func)(const void *buf, size_t len);
+
+/**
+ * @brief CRC-16-CCITT as used by the serial binding, adapted to 'test_crc_func'.
+ * @param buf Pointer to the data.
+ * @param len Number of bytes.
+ * @return The 16 bits frame check sequence.
+ */
+
+static uint32_t test_crc16_ccitt(const void *buf, size_t len)
+{
+    return crc_16_ccitt(FCS_INIT_16, (const uint8_t *) buf, (uint32_t) len);
+}
+
+/* Measured algorithm, selected by the test argument */
+typedef struct test_crc_algo_t
+{
+    const char *  name; /**< Algorithm name */
+    test_crc_func func; /**< One shot CRC over a buffer */
+
+} test_crc_algo;
+
+static const test_crc_algo test_crc_algos[] = {
+    {"CRC-32 (" MCTP_CRC_PROFILE_NAME " tables)", crc32},
+    {"CRC-16-CCITT (" MCTP_CRC_PROFILE_NAME " tables)", test_crc16_ccitt},
+    {"CRC-32C (" MCTP_CRC_PROFILE_NAME " tables)", crc32c},
+};
+
+static uint8_t           test_crc_buffer[TEST_CRC_MAX_SIZE] __attribute__((aligned(4)));
+static size_t            test_crc_size;
+static volatile uint32_t test_crc_result; /* Keeps the CRC from being optimized out */
+
+/**
+ * @brief Runs the selected CRC once over the current buffer size.
+ * @param arg Index of the algorithm in 'test_crc_algos'.
+ */
+
+static void test_crc_run(uintptr_t arg)
+{
+    test_crc_result = test_crc_algos[arg].func(test_crc_buffer, test_crc_size);
+}
+
+/**
+ * @brief Fills the input buffer and warms up the selected algorithm so any
+ *        lazy table initialization is not part of the measurement.
+ * @param arg Index of the algorithm in 'test_crc_algos'.
+ * @return 0 on success, 1 on error.
+ */
+
+int test_crc_prologue(uintptr_t arg)
+{
+    if ( arg >= ARRAY_SIZE(test_crc_algos) )
+        return 1;
+
+    hal_pattern_fill(test_crc_buffer, sizeof(test_crc_buffer), HAL_PATTERN_SEED, 0);
+
+    test_crc_size = TEST_CRC_EXEC_SIZE;
+    test_crc_run(arg);
+
+    return 0;
+}
+
+/**
+ * @brief Measured function: CRC over a 1 KB buffer.
+ * @param arg Index of the algorithm in 'test_crc_algos'.
+ */
+
+void test_exec_crc(uintptr_t arg)
+{
+    test_crc_run(arg);
+}
+
+/**
+ * @brief Sweeps the buffer size from 64 to 4096 bytes and reports the
+ *        throughput of the selected algorithm in bytes per cycle.
+ * @param arg Index of the algorithm in 'test_crc_algos'.
+ * @return Always 0.
+ */
+
+int test_crc_epilog(uintptr_t arg)
+{
+    uint64_t cycles;
+    uint32_t milli;
+
+    hal_console_printf("%s:\n%8s %10s %12s\n", test_crc_algos[arg].name, "Bytes", "Cycles", "Bytes/cycle");
+
+    for ( test_crc_size = TEST_CRC_MIN_SIZE; test_crc_size <= TEST_CRC_MAX_SIZE; test_crc_size *= 2 )
+    {
+        cycles = hal_measure_cycles(test_crc_run, arg);
+        milli  = cycles ? (uint32_t) ((test_crc_size * 1000ULL) / cycles) : 0;
+
+        hal_console_printf("%8u %10llu %8u.%03u\n", (unsigned) test_crc_size, cycles, milli / 1000, milli % 1000);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Provides a description for the CRC throughput test.
+ * @param description_type 0 for a brief one-line description, 1 for an
+ *                         in-depth test description.
+ * @return A pointer to a string containing the description.
+ */
+
+char *test_crc32_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "CRC-32 over a 1 KB buffer.";
+    }
+    else
+    {
+        return "This test measures the libmctp CRC-32 (as used by the astlpc \n"
+               "binding) over a 1 KB buffer using the lookup tables selected by \n"
+               "CRC_PROFILE (nibble, byte or slicing-by-8), the epilogue sweeps \n"
+               "buffers from 64 to 4096 bytes and reports the throughput in \n"
+               "bytes per cycle.\n";
+    }
+}
+
+/**
+ * @brief Provides a description for the CRC-16-CCITT throughput test.
+ * @param description_type 0 for a brief one-line description, 1 for an
+ *                         in-depth test description.
+ * @return A pointer to a string containing the description.
+ */
+
+char *test_crc16_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "CRC-16-CCITT over a 1 KB buffer.";
+    }
+    else
+    {
+        return "This test measures the libmctp CRC-16-CCITT (as used by the \n"
+               "serial binding frame check sequence) over a 1 KB buffer using \n"
+               "the lookup tables selected by CRC_PROFILE (nibble, byte or \n"
+               "slicing-by-4), the epilogue sweeps buffers from 64 to 4096 \n"
+               "bytes and reports the throughput in bytes per cycle.\n";
+    }
+}
+
+/**
+ * @brief Provides a description for the CRC-32C throughput test.
+ * @param description_type 0 for a brief one-line description, 1 for an
+ *                         in-depth test description.
+ * @return A pointer to a string containing the description.
+ */
+
+char *test_crc32c_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "CRC-32C over a 1 KB buffer.";
+    }
+    else
+    {
+        return "This test measures the libmctp CRC-32C (as used by the message \n"
+               "integrity check) over a 1 KB buffer using the lookup tables \n"
+               "selected by CRC_PROFILE (nibble, byte or slicing-by-8), the \n"
+               "epilogue sweeps buffers from 64 to 4096 bytes and reports the \n"
+               "throughput in bytes per cycle.\n";
+    }
+}
@@ -17,6 +17,7 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <hal_llist.h>
 #include <ncsi.h>
 #include <test_frag,h>
@@ -27,6 +28,10 @@
 #define DEFRAG_PERFORM_SEQ_VALIDATION       (1)
 #define DEFRAG_PERFORM_FIRSTBYTE_VALIDATION (1)
 
+/* The assembled stream starts with the last pre-byte of the NC-SI packet,
+   this is where the painted payload lands in it */
+#define DEFRAG_PAYLOAD_OFFSET (NCSI_HEADERS_SIZE - (NCSI_INTEL_PRE_BYTE - 1))
+
 /* Macro to check if a pointer is 1 byte offset from the nearest 
    4-byte aligned address (i.e., unaligned address) */
 #define DEFRAG_CHECK_OPTIMIZED_OFFSET(ptr)                                                                             \
@@ -165,13 +170,19 @@ int test_defrag_epilog(uintptr_t arg)
 #if ( TEST_CONTINUOUS_MODE == 0 )
     if ( p_defrag_test->usb_offset != p_defrag_test->ncsi_packet_size )
     {
-        printf("Error: The assembled packet size (%d) does not match the expected size (%d).\n", p_defrag_test->usb_offset, p_defrag_test->ncsi_packet_size);
+        hal_console_printf("Error: The assembled packet size (%d) does not match the expected size (%d).\n", p_defrag_test->usb_offset, p_defrag_test->ncsi_packet_size);
         if ( p_defrag_test->error )
-            printf("%s", p_defrag_test->error);
+            hal_console_printf("%s", p_defrag_test->error);
+    }
+#if ( HAL_PAINT_PACKET > 0 )
+    else if ( hal_pattern_verify(p_defrag_test->p_ncsi_start + DEFRAG_PAYLOAD_OFFSET, NCSI_GET_PAYLOAD_CLEAN(p_defrag_test->ncsi_packet_size), HAL_PATTERN_SEED, 0) != 0 )
+    {
+        hal_console_printf("Error: The assembled payload does not match the generated pattern.\n");
     }
+#endif
     else
     {
-        printf("Success: Assembled packet (%d total, %d payload) passed all tests.\n", p_defrag_test->ncsi_packet_size,
+        hal_console_printf("Success: Assembled packet (%d total, %d payload) passed all tests.\n", p_defrag_test->ncsi_packet_size,
                NCSI_GET_PAYLOAD_CLEAN(p_defrag_test->ncsi_packet_size));
     }
 #endif
@@ -378,7 +389,7 @@ int test_defrag_prologue(uintptr_t arg)
     p_defrag_test->rx_raw_size = 0;
 
 #if ( TEST_CONTINUOUS_MODE == 0 )
-    printf("Input: %d USB buffers, total %d bytes.\n", p_defrag_test->usb_packets_count, p_defrag_test->usb_raw_size);
+    hal_console_printf("Input: %d USB buffers, total %d bytes.\n", p_defrag_test->usb_packets_count, p_defrag_test->usb_raw_size);
 #endif
     return 0; /* Ready! */
 }
@@ -19,10 +19,13 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <hal_llist.h>
 #include <hal_msgq.h>
 #include <test_defrag.h>
+#include <test_frag,h>
 #include <libmctp-log.h>
+#include <stddef.h>
 #include <string.h>
 
 #define member_size(type, member) (sizeof(((type *) 0)->member))
@@ -52,8 +55,33 @@ typedef struct test_defrag_mctplib_session_t
     struct mctp_binding binding;            /* libmctp binding container */
     mctp_eid_t          eid;                /* Our Endpoint ID */
     mctp_eid_t          dest_eid;           /* Remote Endpoint ID */
-    uintptr_t           msgq_handle;        /* Handle to the message queue */
-    uintptr_t           msgq_contex_handle; /* Handle to the message queue dedicated for context buffers */
+    struct mctp_pktbuf *rx_pkts;            /* Packets built by the prologue, linked through 'next' */
+    size_t              rx_pkts_count;      /* Count of packets in 'rx_pkts' */
+    uint8_t *           rx_buf;             /* Reassembly buffer provided to libmctp */
+    bool                rx_buf_busy;        /* 'rx_buf' is in use by libmctp */
+    uint8_t *           tx_msg;             /* TX test: message sent to the remote EID */
+    ptr_size_pair       usb_pairs[MCTP_USB_TX_MAX_POINTERS]; /* TX test: pointers of the current USB transfer */
+    size_t              usb_transfers;      /* TX test: USB transfers issued */
+    size_t              usb_packets;        /* TX test: MCTP packets carried by these transfers */
+    uint64_t            clock_skew;         /* Added to the system ticks, to age reassembly contexts */
+    uint32_t            timeouts;           /* Timeout test: reclaimed contexts count before the test */
+    struct mctp_binding downstream[MCTP_MAX_BUSSES - 1]; /* Routing test: busses behind us */
+    size_t              routed;             /* Routing test: lookups that found a bus */
+    struct mctp_capture_ring capture;       /* Capture test: ring the packets are recorded in */
+    struct mctp_capture_rec *capture_recs;  /* Capture test: records of 'capture' */
+    struct mctp_log_rec *log_recs;          /* Binary log of MCTP_LOG_BINARY debug builds */
+    size_t              stream_chunks;      /* Stream test: chunks handed over */
+    size_t              stream_bytes;       /* Stream test: bytes handed over */
+    bool                stream_done;        /* Stream test: the last chunk came, nothing was aborted */
+    size_t              req_window;         /* Request test: requests kept in flight */
+    size_t              req_sent;           /* Request test: requests sent */
+    size_t              req_done;           /* Request test: responses received */
+    size_t              req_round_trips;    /* Request test: USB round trips taken */
+    uint8_t             req_tags[8];        /* Request test: tags of the requests awaiting an answer */
+    size_t              req_tags_count;     /* Request test: count of 'req_tags' */
+    size_t              senders;            /* Interleaved test: count of concurrent senders */
+    size_t              rx_count;           /* Interleaved test: messages received intact */
+    size_t              rx_errors;          /* Interleaved test: messages received corrupted */
 
 } test_defrag_mctplib_session;
 
@@ -61,24 +89,15 @@ typedef struct test_defrag_mctplib_session_t
 test_defrag_mctplib_session *p_defrag_lib = NULL;
 
 /**
- * @brief Retrieves the handle to the message queue initialized by this module.
- * @return The message queue handle, or 0 if the module or message queue is not 
- *         initialized.
+ * @brief Clock used by libmctp for its reassembly timeouts.
+ *
+ * @param data Unused user data.
+ * @return Milliseconds since the system started, plus the test skew.
  */
 
-uintptr_t test_defrag_mctplib_get_handle(size_t type)
+static uint64_t test_defrag_mctplib_now(void *data)
 {
-#if ( HAL_PTR_SANITY_CHECKS > 0 )
-    if ( p_defrag_lib == NULL )
-    {
-        return 0;
-    }
-#endif
-
-    if ( type == 0 )
-        return p_defrag_lib->msgq_handle;
-    else
-        return p_defrag_lib->msgq_contex_handle;
+    return hal_get_ticks() + p_defrag_lib->clock_skew;
 }
 
 /**
@@ -96,24 +115,120 @@ uintptr_t test_defrag_mctplib_get_handle(size_t type)
 static void test_defrag_mctplib_dummy_rx(uint8_t eid, bool tag_owner, uint8_t msg_tag, void *data, void *msg, size_t len)
 {
 #ifdef DEBUG
-    printf("Dummy RX receiver got a message from EID %d, length %d bytes.\n", eid, len);
+    hal_console_printf("Dummy RX receiver got a message from EID %d, length %d bytes.\n", eid, len);
 #endif
 }
 
+/**
+ * @brief Executed by libmctp in place of the dummy RX receiver when zero-copy
+ * delivery is selected: the message is handed over as the list of its fragments.
+ *
+ * @param eid The endpoint identifier to which the message was sent.
+ * @param tag_owner Boolean indicating if the tag is owned.
+ * @param msg_tag The message tag.
+ * @param data Pointer to the data received.
+ * @param pkts The received packets, linked through 'next'.
+ * @param len Length of the message in bytes.
+ */
+
+static void test_defrag_mctplib_dummy_rx_pkts(uint8_t eid, bool tag_owner, uint8_t msg_tag, void *data, struct mctp_pktbuf *pkts, size_t len)
+{
+#ifdef DEBUG
+    size_t count = 0;
+
+    for ( ; pkts != NULL; pkts = pkts->next ) count++;
+
+    hal_console_printf("Dummy RX receiver got a message from EID %d, length %d bytes in %d packets.\n", eid, len, count);
+#endif
+}
+
+/**
+ * @brief Executed by libmctp for every fragment when the message type is streamed:
+ * the chunks come in order as the packets arrive, and nothing is reassembled.
+ *
+ * @param eid The endpoint identifier of the sender.
+ * @param tag_owner Boolean indicating if the tag is owned.
+ * @param msg_tag The message tag.
+ * @param data Unused user data.
+ * @param flags MCTP_RX_STREAM_SOM on the first chunk, _EOM on the last, _ABORT when dropped.
+ * @param chunk The bytes of the message carried by the packet.
+ * @param len Length of the chunk in bytes.
+ */
+
+static void test_defrag_mctplib_dummy_rx_stream(uint8_t eid, bool tag_owner, uint8_t msg_tag, void *data, unsigned int flags, const void *chunk,
+                                                size_t len)
+{
+    if ( flags & MCTP_RX_STREAM_SOM )
+    {
+        p_defrag_lib->stream_chunks = 0;
+        p_defrag_lib->stream_bytes  = 0;
+    }
+
+    p_defrag_lib->stream_chunks++;
+    p_defrag_lib->stream_bytes += len;
+    p_defrag_lib->stream_done = (flags & MCTP_RX_STREAM_EOM) != 0;
+}
+
+/**
+ * @brief Provides libmctp with the buffer to reassemble a message into.
+ * As with the NC-SI defrag path, the message starts 1 byte past an aligned
+ * address so that the payload following the 3 bytes long prefix is aligned.
+ *
+ * @param eid The endpoint identifier of the sender.
+ * @param msg_tag The message tag.
+ * @param data Unused user data.
+ * @param rx_buf Filled with the destination buffer.
+ * @return 0 when a buffer is provided, 1 to have libmctp use its own.
+ */
+
+static int test_defrag_mctplib_rx_buf_get(uint8_t eid, uint8_t msg_tag, void *data, struct mctp_rx_buf *rx_buf)
+{
+    if ( p_defrag_lib->rx_buf == NULL || p_defrag_lib->rx_buf_busy )
+        return 1;
+
+    p_defrag_lib->rx_buf_busy = true;
+    rx_buf->buf               = p_defrag_lib->rx_buf;
+    rx_buf->offset            = MCTP_USB_RX_BUF_OFFSET;
+    rx_buf->size              = MCTP_USB_MAX_CONTEXT_SIZE;
+
+    return 0;
+}
+
+/**
+ * @brief Returned by libmctp once done with a buffer from test_defrag_mctplib_rx_buf_get().
+ *
+ * @param data Unused user data.
+ * @param buf The buffer returned.
+ */
+
+static void test_defrag_mctplib_rx_buf_put(void *data, void *buf)
+{
+    p_defrag_lib->rx_buf_busy = false;
+}
+
 /**
  * @brief Executes the defragmentation test using libmctp.
  * This function simulates the reception of a sequence of fragmented packets,
  * pushes them through the libmctp handler, and expects them to be reassembled and passed to the dummy RX receiver.
  * 
- * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @param arg 0 to hand the packets to libmctp one by one, 1 to hand them all at once
+ *            as if carried by a single USB transfer.
  */
 
 void test_exec_defrag_mctplib(uintptr_t arg)
 {
-    struct mctp_pktbuf *pkt;
+    struct mctp_pktbuf *pkt, *next;
 
-    while ( (pkt = (struct mctp_pktbuf *) msgq_get_next(p_defrag_lib->msgq_handle, 1, true)) != NULL )
+    if ( arg == 1 )
     {
+        mctp_bus_rx_batch(&p_defrag_lib->binding, p_defrag_lib->rx_pkts, p_defrag_lib->rx_pkts_count);
+        return;
+    }
+
+    /* One packet at a time, libmctp may free it on the way */
+    for ( pkt = p_defrag_lib->rx_pkts; pkt != NULL; pkt = next )
+    {
+        next = pkt->next;
         mctp_bus_rx(&p_defrag_lib->binding, pkt);
     }
 }
@@ -123,7 +238,10 @@ void test_exec_defrag_mctplib(uintptr_t arg)
  * This prolog function creates and initializes a series of MCTP packets, setting the correct
  * destination ID and sequence, ready to be processed by the libmctp Rx handler.
  * 
- * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @param arg 0 to have the message copied into a context buffer, 1 to have it
+ *            delivered as the list of its fragments (zero-copy), 2 to have it
+ *            copied straight into a buffer of ours, 3 as 0 with the packets
+ *            recorded in a capture ring, 4 to have it streamed chunk by chunk.
  * @return Status of the operation, 0 on success, non-zero on failure.
  */
 
@@ -132,6 +250,7 @@ int test_defrag_mctplib_prologue(uintptr_t arg)
     uint8_t             frgas_count = 0;
     char                color_byte  = 'A';
     struct mctp_pktbuf *pkt         = NULL;
+    struct mctp_pktbuf **link       = &p_defrag_lib->rx_pkts;
     mctplib_packet *    p_mctp, *p_last_mctp = NULL;
 
     /* Pre-build about 25 MCTP messages */
@@ -148,17 +267,640 @@ int test_defrag_mctplib_prologue(uintptr_t arg)
         frgas_count++;
         color_byte++;
 
+        /* Also chained in order, as received in a single USB transfer */
+        *link = pkt;
+        link  = &pkt->next;
+
         /* Keep track of the last frame */
         p_last_mctp = p_mctp;
     }
 
     /* Mark the last MCTP message */
     p_last_mctp->end_of_message = 1;
+    *link                       = NULL;
+    p_defrag_lib->rx_pkts_count = frgas_count;
 
     /* Register a dummy receiver */
+    mctp_set_rx_pkts(p_defrag_lib->p_mctp, (arg == 1) ? test_defrag_mctplib_dummy_rx_pkts : NULL, NULL);
+
+    /* The message type is the first color byte */
+    p_defrag_lib->stream_done = false;
+    mctp_set_rx_stream(p_defrag_lib->p_mctp, 'A', (arg == 4) ? test_defrag_mctplib_dummy_rx_stream : NULL, NULL);
+
+    /* Packet capture, drained by the epilog */
+    if ( arg == 3 )
+    {
+        mctp_capture_ring_init(&p_defrag_lib->capture, p_defrag_lib->capture_recs, MCTP_USB_CAPTURE_RECORDS, xt_iss_cycle_count);
+        mctp_set_capture_ring(p_defrag_lib->p_mctp, &p_defrag_lib->capture);
+    }
+    else
+        mctp_set_capture_ring(p_defrag_lib->p_mctp, NULL);
+
+    /* Reassembly destination */
+    if ( arg == 2 )
+        mctp_set_rx_buf_ops(p_defrag_lib->p_mctp, test_defrag_mctplib_rx_buf_get, test_defrag_mctplib_rx_buf_put, NULL);
+    else
+        mctp_set_rx_buf_ops(p_defrag_lib->p_mctp, NULL, NULL, NULL);
+
     return mctp_set_rx_all(p_defrag_lib->p_mctp, test_defrag_mctplib_dummy_rx, NULL);
 }
 
+/**
+ * @brief Executed by libmctp when one of the interleaved messages is fully assembled.
+ * Each sender fills its message with its own color byte, so a message mixed up with
+ * another sender's fragments is caught by checking both ends of the buffer.
+ *
+ * @param eid The endpoint identifier of the sender.
+ * @param tag_owner Boolean indicating if the tag is owned.
+ * @param msg_tag The message tag.
+ * @param data Unused user data.
+ * @param msg Pointer to the complete message.
+ * @param len Length of the message in bytes.
+ */
+
+static void test_defrag_mctplib_interleaved_rx(uint8_t eid, bool tag_owner, uint8_t msg_tag, void *data, void *msg, size_t len)
+{
+    uint8_t color = 'A' + (eid - p_defrag_lib->dest_eid);
+    uint8_t *p    = msg;
+
+    if ( len == MCTP_USB_INTERLEAVED_MSG_SIZE && p[0] == color && p[len - 1] == color )
+        p_defrag_lib->rx_count++;
+    else
+        p_defrag_lib->rx_errors++;
+}
+
+/**
+ * @brief Sets up the interleaved defragmentation test (libmctp).
+ * Registers the verifying receiver and resets the counters, the packets themselves
+ * are built on the fly since the frames pool can not hold all of them.
+ *
+ * @param arg Count of concurrent senders, at most MCTP_MSG_CTX_COUNT.
+ * @return 0 on success, non-zero on failure.
+ */
+
+int test_defrag_mctplib_interleaved_prologue(uintptr_t arg)
+{
+    if ( arg == 0 || arg > MCTP_MSG_CTX_COUNT )
+        return 1;
+
+    p_defrag_lib->senders   = arg;
+    p_defrag_lib->rx_count  = 0;
+    p_defrag_lib->rx_errors = 0;
+
+    return mctp_set_rx_all(p_defrag_lib->p_mctp, test_defrag_mctplib_interleaved_rx, NULL);
+}
+
+/**
+ * @brief Executes the interleaved defragmentation test using libmctp.
+ * Each sender (a distinct source EID) transmits a 1500 bytes message as 64 bytes
+ * fragments, the senders taking turns fragment by fragment so that all the
+ * reassembly contexts are in flight at once.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ */
+
+void test_exec_defrag_mctplib_interleaved(uintptr_t arg)
+{
+    struct mctp_pktbuf *pkt;
+    mctplib_packet *    p_mctp;
+    size_t              offset, len, sender;
+    uint8_t             seq = 0;
+
+    for ( offset = 0; offset < MCTP_USB_INTERLEAVED_MSG_SIZE; offset += len, seq++ )
+    {
+        len = MCTP_USB_INTERLEAVED_MSG_SIZE - offset;
+        if ( len > member_size(mctplib_packet, payload) )
+            len = member_size(mctplib_packet, payload);
+
+        for ( sender = 0; sender < p_defrag_lib->senders; sender++ )
+        {
+            pkt = mctp_pktbuf_alloc(&p_defrag_lib->binding, offsetof(mctplib_packet, payload) + len);
+            if ( pkt == NULL )
+                return;
+
+            p_mctp                   = (mctplib_packet *) MCTP_PKTBUF_HDR(pkt);
+            p_mctp->version          = 1;
+            p_mctp->dest             = p_defrag_lib->eid;
+            p_mctp->src              = p_defrag_lib->dest_eid + sender;
+            p_mctp->message_tag      = 0;
+            p_mctp->tag_owner        = 1;
+            p_mctp->packet_sequence  = seq;
+            p_mctp->start_of_message = (offset == 0);
+            p_mctp->end_of_message   = (offset + len == MCTP_USB_INTERLEAVED_MSG_SIZE);
+
+            memset(p_mctp->payload, 'A' + sender, len);
+
+            /* The packet is released by libmctp */
+            mctp_bus_rx(&p_defrag_lib->binding, pkt);
+        }
+    }
+}
+
+/**
+ * @brief Reports the outcome of the interleaved defragmentation test.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when every sender's message was received intact, else 1.
+ */
+
+int test_defrag_mctplib_interleaved_epilog(uintptr_t arg)
+{
+    if ( p_defrag_lib->rx_count != p_defrag_lib->senders || p_defrag_lib->rx_errors )
+    {
+        hal_console_printf("Error: %d of %d interleaved messages received, %d corrupted.\n", p_defrag_lib->rx_count, p_defrag_lib->senders,
+                           p_defrag_lib->rx_errors);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d interleaved messages of %d bytes reassembled.\n", p_defrag_lib->rx_count, MCTP_USB_INTERLEAVED_MSG_SIZE);
+    return 0;
+}
+
+/**
+ * @brief Dummy USB transfer, where the pointers would be handed to the USB peripheral.
+ *
+ * @param pairs       Pointers and sizes making up the transfer.
+ * @param pairs_count Count of entries in 'pairs'.
+ * @param packets     Count of MCTP packets carried.
+ */
+
+static void test_defrag_mctplib_usb_tx(ptr_size_pair *pairs, size_t pairs_count, size_t packets)
+{
+#if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
+    hal_console_printf("\tUSB op. # %u: %u pointers, %u packets\n", p_defrag_lib->usb_transfers, pairs_count, packets);
+#endif
+
+    p_defrag_lib->usb_transfers++;
+    p_defrag_lib->usb_packets += packets;
+}
+
+/**
+ * @brief libmctp binding TX: one USB transfer per packet.
+ *
+ * @param binding The USB binding.
+ * @param pkt     The packet to send.
+ * @return 0, the packet was sent.
+ */
+
+static int test_defrag_mctplib_binding_tx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+{
+    p_defrag_lib->usb_pairs[0].ptr  = (uintptr_t) MCTP_PKTBUF_HDR(pkt);
+    p_defrag_lib->usb_pairs[0].size = MCTP_PKTBUF_SIZE(pkt);
+    test_defrag_mctplib_usb_tx(p_defrag_lib->usb_pairs, 1, 1);
+
+    return 0;
+}
+
+/**
+ * @brief libmctp binding batched TX: packs as many queued packets as one USB transfer
+ * takes, bound by MCTP_USB_TX_MAX_BYTES and MCTP_USB_TX_MAX_POINTERS. A packet whose
+ * payload was left in the sender's memory takes a second pointer.
+ *
+ * @param binding The USB binding.
+ * @param pkts    Queued packets, linked through 'next'.
+ * @param n       Count of queued packets.
+ * @return Count of packets sent.
+ */
+
+static int test_defrag_mctplib_binding_tx_batch(struct mctp_binding *binding, struct mctp_pktbuf *pkts, size_t n)
+{
+    size_t pairs_count = 0, bytes = 0, packets, size;
+
+    for ( packets = 0; packets < n; packets++, pkts = pkts->next )
+    {
+        size = MCTP_PKTBUF_SIZE(pkts);
+        if ( bytes + size + pkts->ext_len > MCTP_USB_TX_MAX_BYTES || pairs_count + 1 + (pkts->ext_len != 0) > MCTP_USB_TX_MAX_POINTERS )
+            break;
+
+        p_defrag_lib->usb_pairs[pairs_count].ptr  = (uintptr_t) MCTP_PKTBUF_HDR(pkts);
+        p_defrag_lib->usb_pairs[pairs_count].size = size;
+        pairs_count++;
+
+        if ( pkts->ext_len )
+        {
+            p_defrag_lib->usb_pairs[pairs_count].ptr  = (uintptr_t) pkts->ext_data;
+            p_defrag_lib->usb_pairs[pairs_count].size = pkts->ext_len;
+            pairs_count++;
+        }
+
+        bytes += size + pkts->ext_len;
+    }
+
+    test_defrag_mctplib_usb_tx(p_defrag_lib->usb_pairs, pairs_count, packets);
+
+    return packets;
+}
+
+/**
+ * @brief Sets up the USB transmit test.
+ *
+ * @param arg 0 to send each packet in a USB transfer of its own, 1 to have libmctp
+ *            hand the binding batches of packets.
+ * @return 0 on success, non-zero on failure.
+ */
+
+int test_defrag_mctplib_tx_prologue(uintptr_t arg)
+{
+    size_t i;
+
+    if ( p_defrag_lib->tx_msg == NULL )
+        return 1;
+
+    p_defrag_lib->binding.tx       = (arg == 0) ? test_defrag_mctplib_binding_tx : NULL;
+    p_defrag_lib->binding.tx_batch = (arg == 1) ? test_defrag_mctplib_binding_tx_batch : NULL;
+    p_defrag_lib->usb_transfers    = 0;
+    p_defrag_lib->usb_packets      = 0;
+
+    /* NC-SI like payload, the type byte without the integrity check bit */
+    for ( i = 0; i < MCTP_USB_TX_MSG_SIZE; i++ ) p_defrag_lib->tx_msg[i] = i & 0x7f;
+
+    return 0;
+}
+
+/**
+ * @brief Executes the USB transmit test: a 1500 bytes message is fragmented by libmctp
+ * and sent over the USB binding.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ */
+
+void test_exec_defrag_mctplib_tx(uintptr_t arg)
+{
+    mctp_message_tx(p_defrag_lib->p_mctp, p_defrag_lib->dest_eid, true, 0, p_defrag_lib->tx_msg, MCTP_USB_TX_MSG_SIZE);
+}
+
+/**
+ * @brief Reports the outcome of the USB transmit test.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when the whole message was sent, else 1.
+ */
+
+int test_defrag_mctplib_tx_epilog(uintptr_t arg)
+{
+    size_t mtu      = MCTP_BODY_SIZE(p_defrag_lib->binding.pkt_size);
+    size_t expected = (MCTP_USB_TX_MSG_SIZE + mtu - 1) / mtu;
+
+    if ( p_defrag_lib->usb_packets != expected )
+    {
+        hal_console_printf("Error: %d of %d packets sent.\n", p_defrag_lib->usb_packets, expected);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d packets sent in %d USB transfers.\n", p_defrag_lib->usb_packets, p_defrag_lib->usb_transfers);
+    return 0;
+}
+
+char *test_defrag_mctplib_tx_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "USB transmit using libmctp.";
+    }
+    else
+    {
+        return "In this test a 1500 bytes message is fragmented by libmctp and sent over the USB binding,\n"
+               "either one packet per USB transfer or packed in batches of up to 512 bytes and 16 pointers.\n";
+    }
+}
+
+/**
+ * @brief libmctp binding TX for the request test: the remote endpoint takes note
+ * of the request, it answers once the USB transfer turned around.
+ *
+ * @param binding The USB binding.
+ * @param pkt     The request packet.
+ * @return 0, the packet was sent.
+ */
+
+static int test_defrag_mctplib_req_tx(struct mctp_binding *binding, struct mctp_pktbuf *pkt)
+{
+    struct mctp_hdr *hdr = MCTP_PKTBUF_HDR(pkt);
+
+    if ( hdr->flags_seq_tag & MCTP_HDR_FLAG_EOM )
+        p_defrag_lib->req_tags[p_defrag_lib->req_tags_count++] = hdr->flags_seq_tag & MCTP_HDR_TAG_MASK;
+
+    return 0;
+}
+
+/**
+ * @brief Response handler of the request test.
+ */
+
+static void test_defrag_mctplib_req_response(mctp_eid_t eid, uint8_t msg_tag, void *data, void *msg, size_t len)
+{
+    if ( msg != NULL )
+        p_defrag_lib->req_done++;
+}
+
+/**
+ * @brief Sets up the request test.
+ *
+ * @param arg Requests kept in flight, 1 (one at a time) to 8 (one per tag).
+ * @return 0 on success, non-zero on failure.
+ */
+
+int test_defrag_mctplib_req_prologue(uintptr_t arg)
+{
+    if ( arg == 0 || arg > ARRAY_SIZE(p_defrag_lib->req_tags) || p_defrag_lib->tx_msg == NULL )
+        return 1;
+
+    p_defrag_lib->binding.tx       = test_defrag_mctplib_req_tx;
+    p_defrag_lib->binding.tx_batch = NULL;
+    p_defrag_lib->req_window       = arg;
+    p_defrag_lib->req_sent         = 0;
+    p_defrag_lib->req_done         = 0;
+    p_defrag_lib->req_round_trips  = 0;
+    p_defrag_lib->req_tags_count   = 0;
+
+    memset(p_defrag_lib->tx_msg, 0x01, MCTP_USB_REQ_SIZE);
+
+    return 0;
+}
+
+/**
+ * @brief Executes the request test: MCTP_USB_REQ_COUNT requests are sent to the
+ * remote EID, which answers those of a USB transfer in the next one. Requests
+ * are kept in flight up to the window, so a round trip carries that many.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ */
+
+void test_exec_defrag_mctplib_req(uintptr_t arg)
+{
+    struct mctp_pktbuf *pkt;
+    mctplib_packet *    p_mctp;
+    size_t              i;
+
+    while ( p_defrag_lib->req_done < MCTP_USB_REQ_COUNT )
+    {
+        /* Fill the window */
+        while ( p_defrag_lib->req_sent - p_defrag_lib->req_done < p_defrag_lib->req_window && p_defrag_lib->req_sent < MCTP_USB_REQ_COUNT )
+        {
+            if ( mctp_message_request(p_defrag_lib->p_mctp, p_defrag_lib->dest_eid, p_defrag_lib->tx_msg, MCTP_USB_REQ_SIZE,
+                                      test_defrag_mctplib_req_response, NULL) < 0 )
+                break;
+
+            p_defrag_lib->req_sent++;
+        }
+
+        if ( p_defrag_lib->req_tags_count == 0 )
+            break;
+
+        /* The responses come back in one transfer */
+        p_defrag_lib->req_round_trips++;
+        for ( i = 0; i < p_defrag_lib->req_tags_count; i++ )
+        {
+            pkt = mctp_pktbuf_alloc(&p_defrag_lib->binding, sizeof(mctplib_packet));
+            if ( pkt == NULL )
+                break;
+
+            p_mctp                   = (mctplib_packet *) MCTP_PKTBUF_HDR(pkt);
+            p_mctp->version          = 1;
+            p_mctp->dest             = p_defrag_lib->eid;
+            p_mctp->src              = p_defrag_lib->dest_eid;
+            p_mctp->message_tag      = p_defrag_lib->req_tags[i];
+            p_mctp->tag_owner        = 0;
+            p_mctp->packet_sequence  = 0;
+            p_mctp->start_of_message = 1;
+            p_mctp->end_of_message   = 1;
+
+            memset(p_mctp->payload, 0x01, sizeof(p_mctp->payload));
+            mctp_bus_rx(&p_defrag_lib->binding, pkt);
+        }
+
+        p_defrag_lib->req_tags_count = 0;
+    }
+}
+
+/**
+ * @brief Reports the outcome of the request test.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when every request was answered, else 1.
+ */
+
+int test_defrag_mctplib_req_epilog(uintptr_t arg)
+{
+    if ( p_defrag_lib->req_done != MCTP_USB_REQ_COUNT )
+    {
+        hal_console_printf("Error: %d of %d requests answered.\n", p_defrag_lib->req_done, MCTP_USB_REQ_COUNT);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d requests answered in %d round trips.\n", p_defrag_lib->req_done, p_defrag_lib->req_round_trips);
+    return 0;
+}
+
+char *test_defrag_mctplib_req_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Pipelined requests using libmctp.";
+    }
+    else
+    {
+        return "In this test requests are sent to an endpoint answering a USB transfer in the next one,\n"
+               "either one at a time or up to 8 in flight, each with its own tag, the responses being\n"
+               "matched to their request by libmctp. Over a latency bound link the request rate\n"
+               "grows with the requests carried per round trip.\n";
+    }
+}
+
+/**
+ * @brief Sets up the reassembly timeout test: every sender starts a message whose
+ * EOM never arrives, leaving all the reassembly contexts held.
+ *
+ * @param arg Count of senders, at most MCTP_MSG_CTX_COUNT.
+ * @return 0 on success, non-zero on failure.
+ */
+
+int test_defrag_mctplib_timeout_prologue(uintptr_t arg)
+{
+    struct mctp_pktbuf *pkt;
+    struct mctp_stats   stats;
+    mctplib_packet *    p_mctp;
+    size_t              sender;
+
+    if ( arg == 0 || arg > MCTP_MSG_CTX_COUNT )
+        return 1;
+
+    p_defrag_lib->senders = arg;
+    mctp_poll(p_defrag_lib->p_mctp);
+
+    for ( sender = 0; sender < p_defrag_lib->senders; sender++ )
+    {
+        pkt = mctp_pktbuf_alloc(&p_defrag_lib->binding, sizeof(mctplib_packet));
+        if ( pkt == NULL )
+            return 1;
+
+        p_mctp                   = (mctplib_packet *) MCTP_PKTBUF_HDR(pkt);
+        p_mctp->version          = 1;
+        p_mctp->dest             = p_defrag_lib->eid;
+        p_mctp->src              = p_defrag_lib->dest_eid + sender;
+        p_mctp->message_tag      = 0;
+        p_mctp->tag_owner        = 1;
+        p_mctp->packet_sequence  = 0;
+        p_mctp->start_of_message = 1;
+        p_mctp->end_of_message   = 0;
+
+        memset(p_mctp->payload, 'A' + sender, sizeof(p_mctp->payload));
+        mctp_bus_rx(&p_defrag_lib->binding, pkt);
+    }
+
+    mctp_get_stats(p_defrag_lib->p_mctp, &stats);
+    p_defrag_lib->timeouts = stats.rx_ctx_timeouts;
+
+    return 0;
+}
+
+/**
+ * @brief Executes the reassembly timeout test: the clock is moved past the
+ * timeout and libmctp is polled, reclaiming the held contexts.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ */
+
+void test_exec_defrag_mctplib_timeout(uintptr_t arg)
+{
+    p_defrag_lib->clock_skew += MCTP_MSG_CTX_TIMEOUT + (2 * MCTP_MSG_CTX_WHEEL_TICK);
+    mctp_poll(p_defrag_lib->p_mctp);
+}
+
+/**
+ * @brief Reports the outcome of the reassembly timeout test.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when every stale context was reclaimed, else 1.
+ */
+
+int test_defrag_mctplib_timeout_epilog(uintptr_t arg)
+{
+    struct mctp_stats stats;
+
+    mctp_get_stats(p_defrag_lib->p_mctp, &stats);
+    if ( stats.rx_ctx_timeouts - p_defrag_lib->timeouts != p_defrag_lib->senders )
+    {
+        hal_console_printf("Error: %d of %d stale contexts reclaimed.\n", stats.rx_ctx_timeouts - p_defrag_lib->timeouts, p_defrag_lib->senders);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d stale contexts reclaimed.\n", p_defrag_lib->senders);
+    return 0;
+}
+
+char *test_defrag_mctplib_timeout_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Reassembly timeouts using libmctp.";
+    }
+    else
+    {
+        return "In this test messages whose EOM is lost hold all the libmctp reassembly contexts,\n"
+               "the clock is then moved past the timeout and the timer wheel poll reclaims them.\n";
+    }
+}
+
+/**
+ * @brief Sets up the routing test: the USB bus stays the default route and each
+ * extra bus is given a range of 32 EIDs, as for the pool of a downstream bridge.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 on success, non-zero on failure.
+ */
+
+int test_mctplib_route_prologue(uintptr_t arg)
+{
+    struct mctp_binding *binding;
+    size_t               i;
+
+    for ( i = 0; i < ARRAY_SIZE(p_defrag_lib->downstream); i++ )
+    {
+        binding = &p_defrag_lib->downstream[i];
+        if ( binding->bus == NULL )
+        {
+            binding->name           = "downstream";
+            binding->version        = 1;
+            binding->pkt_size       = MCTP_PACKET_SIZE(MCTP_BTU);
+            binding->pkt_pool_count = MCTP_USB_ROUTE_POOL_FRAMES;
+
+            if ( mctp_register_bus(p_defrag_lib->p_mctp, binding, p_defrag_lib->eid) != 0 )
+                return 1;
+        }
+
+        if ( mctp_route_add(p_defrag_lib->p_mctp, 0x20 + (i * 32), 0x3f + (i * 32), binding) != 0 )
+            return 1;
+    }
+
+    p_defrag_lib->routed = 0;
+
+    return 0;
+}
+
+/**
+ * @brief Executes the routing test: resolves the bus of every possible EID.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ */
+
+void test_exec_mctplib_route(uintptr_t arg)
+{
+    unsigned int eid;
+
+    for ( eid = 0; eid < 256; eid++ )
+    {
+        if ( mctp_route_lookup(p_defrag_lib->p_mctp, eid) != NULL )
+            p_defrag_lib->routed++;
+    }
+}
+
+/**
+ * @brief Reports the outcome of the routing test.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when every EID was routed, else 1.
+ */
+
+int test_mctplib_route_epilog(uintptr_t arg)
+{
+    if ( p_defrag_lib->routed != 256 )
+    {
+        hal_console_printf("Error: %d of 256 EIDs routed.\n", p_defrag_lib->routed);
+        return 1;
+    }
+
+    hal_console_printf("Success: 256 EIDs routed over %d busses.\n", MCTP_MAX_BUSSES);
+    return 0;
+}
+
+char *test_mctplib_route_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "EID routing using libmctp.";
+    }
+    else
+    {
+        return "In this test the bus of each of the 256 EIDs is resolved through the libmctp routing table,\n"
+               "with the USB bus as the default route and EID ranges routed to the other busses.\n";
+    }
+}
+
+char *test_defrag_mctplib_interleaved_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "'defrag' interleaved senders using libmctp.";
+    }
+    else
+    {
+        return "In this test up to 8 senders transmit 1500 bytes messages as 64 bytes fragments, taking turns\n"
+               "fragment by fragment, through a dummy USB bus. Every reassembly context is in flight at once,\n"
+               "which measures the context lookup along with the reassembly itself.\n";
+    }
+}
+
 /**
  * @brief Initializes the MCTP fragmentation test environment over USB using libmctp.
  *
@@ -173,6 +915,128 @@ int test_defrag_mctplib_prologue(uintptr_t arg)
  *         or if libmctp fails to initialize.
  */
 
+/**
+ * @brief Drains the capture ring filled by the capture test, checking a record
+ * was taken for each packet.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when every packet was recorded, else 1.
+ */
+
+int test_defrag_mctplib_capture_epilog(uintptr_t arg)
+{
+    const struct mctp_capture_rec *rec;
+    size_t                         n, total = 0;
+
+    while ( (n = mctp_capture_ring_peek(&p_defrag_lib->capture, &rec)) )
+    {
+        total += n;
+        mctp_capture_ring_consume(&p_defrag_lib->capture, n);
+    }
+
+    mctp_set_capture_ring(p_defrag_lib->p_mctp, NULL);
+
+    if ( total != p_defrag_lib->rx_pkts_count || p_defrag_lib->capture.dropped )
+    {
+        hal_console_printf("Error: %d of %d packets captured, %d dropped.\n", total, p_defrag_lib->rx_pkts_count, p_defrag_lib->capture.dropped);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d packets captured.\n", total);
+    return 0;
+}
+
+char *test_defrag_mctplib_capture_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Defragmentation with packet capture using libmctp.";
+    }
+    else
+    {
+        return "In this test the libmctp defragmentation runs with the capture ring enabled: the first\n"
+               "bytes of every packet are copied into a preallocated record stamped with the cycle count,\n"
+               "drained after the run. The difference with the plain test is the cost of capturing.\n";
+    }
+}
+
+/**
+ * @brief Checks the stream test got the whole message, one chunk per packet.
+ *
+ * @param arg Unused argument, included for compatibility with function pointer expectations.
+ * @return 0 when the message was streamed in full, else 1.
+ */
+
+int test_defrag_mctplib_stream_epilog(uintptr_t arg)
+{
+    size_t bytes = p_defrag_lib->rx_pkts_count * (sizeof(mctplib_packet) - sizeof(struct mctp_hdr));
+
+    mctp_set_rx_stream(p_defrag_lib->p_mctp, 'A', NULL, NULL);
+
+    if ( ! p_defrag_lib->stream_done || p_defrag_lib->stream_chunks != p_defrag_lib->rx_pkts_count || p_defrag_lib->stream_bytes != bytes )
+    {
+        hal_console_printf("Error: %d bytes in %d chunks streamed, expected %d in %d.\n", p_defrag_lib->stream_bytes, p_defrag_lib->stream_chunks,
+                           bytes, p_defrag_lib->rx_pkts_count);
+        return 1;
+    }
+
+    hal_console_printf("Success: %d bytes streamed in %d chunks.\n", p_defrag_lib->stream_bytes, p_defrag_lib->stream_chunks);
+    return 0;
+}
+
+char *test_defrag_mctplib_stream_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Streamed defragmentation using libmctp.";
+    }
+    else
+    {
+        return "In this test the message type is streamed: libmctp hands each fragment over as it arrives,\n"
+               "in order, and its context only keeps the sequence state. No context buffer is used, so the\n"
+               "message size is not bound by it.\n";
+    }
+}
+
+char *test_defrag_mctplib_batch_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Batched defragmentation using libmctp.";
+    }
+    else
+    {
+        return "In this test the fragments of a message are handed to libmctp at once, as received\n"
+               "in a single USB transfer, through mctp_bus_rx_batch() rather than one mctp_bus_rx() call each.\n";
+    }
+}
+
+char *test_defrag_mctplib_scatter_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "'defrag' zero-copy using libmctp.";
+    }
+    else
+    {
+        return "Same as the libmctp 'defrag' test, except that the fragments are not copied into a context buffer:\n"
+               "libmctp keeps the received packets and hands the message over as the list of its fragments.\n";
+    }
+}
+
+char *test_defrag_mctplib_rx_buf_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "'defrag' into our buffer using libmctp.";
+    }
+    else
+    {
+        return "Same as the libmctp 'defrag' test, except that libmctp reassembles the fragments straight into\n"
+               "a buffer provided by the test, at the same 1 byte offset as the NC-SI defrag path.\n";
+    }
+}
+
 char *test_defrag_mctplib_desc(size_t description_type)
 {
     if ( description_type == 0 )
@@ -208,21 +1072,23 @@ int test_defrag_mctplib_init(uintptr_t arg)
     if ( p_defrag_lib == NULL )
         return 0;
 
+    /* Routing test busses are registered on first use */
+    hal_zero_buf(p_defrag_lib->downstream, sizeof(p_defrag_lib->downstream));
+
     /* 
-     * Create message queue pool to be used with libmctp. Later, we can use 
-     * msgq_request() and msgq_release() to manage buffers in the free-busy list 
-     * managed by the 'msgq' module.
+     * libmctp builds its pools on the 'msgq' module: the reassembly buffers
+     * and the packets of each binding, once the bus is registered.
      */
 
-    /* Pool for MCTP packets */
-    p_defrag_lib->msgq_handle = msgq_create(MCTP_USB_MSGQ_MAX_FRAME_SIZE, MCTP_USB_MSGQ_ALLOCATED_FRAMES);
-    if ( p_defrag_lib->msgq_handle == 0 )
-        return 0;
+    /* Reassembly buffer we provide libmctp with, aligned as hal_alloc() is */
+    p_defrag_lib->rx_buf      = hal_alloc(MCTP_USB_MAX_CONTEXT_SIZE + MCTP_USB_RX_BUF_OFFSET);
+    p_defrag_lib->rx_buf_busy = false;
 
-    /* Pool for MCTP context buffers */
-    p_defrag_lib->msgq_contex_handle = msgq_create(MCTP_USB_MAX_CONTEXT_SIZE, MCTP_USB_MSGQ_ALLOCATED_CONTEXTS);
-    if ( p_defrag_lib->msgq_contex_handle == 0 )
-        return 0;
+    /* Message sent by the TX test */
+    p_defrag_lib->tx_msg = hal_alloc(MCTP_USB_TX_MSG_SIZE);
+
+    /* Records of the capture test */
+    p_defrag_lib->capture_recs = hal_alloc(MCTP_USB_CAPTURE_RECORDS * sizeof(struct mctp_capture_rec));
 
     /* Initialize libmctp, assert on error. */
     p_defrag_lib->p_mctp = mctp_init();
@@ -234,7 +1100,15 @@ int test_defrag_mctplib_init(uintptr_t arg)
 
     mctp_set_max_message_size(p_defrag_lib->p_mctp, MCTP_USB_MSGQ_MAX_FRAME_SIZE);
 
-#ifdef DEBUG
+    /* Reassembly timeouts run on the system ticks */
+    p_defrag_lib->clock_skew = 0;
+    mctp_set_now_op(p_defrag_lib->p_mctp, test_defrag_mctplib_now, NULL);
+
+#if defined(DEBUG) && defined(MCTP_LOG_BINARY)
+    /* Dump 'log_recs' from the simulator and decode with resources/mctp_log_decode.py */
+    p_defrag_lib->log_recs = hal_alloc(MCTP_USB_LOG_RECORDS * sizeof(struct mctp_log_rec));
+    mctp_set_log_binary(p_defrag_lib->log_recs, MCTP_USB_LOG_RECORDS, MCTP_LOG_DEBUG);
+#elif defined(DEBUG)
     mctp_set_log_stdio(MCTP_LOG_DEBUG);
 #endif
 
@@ -242,10 +1116,19 @@ int test_defrag_mctplib_init(uintptr_t arg)
     p_defrag_lib->binding.name        = "USB";
     p_defrag_lib->binding.version     = 1;
     p_defrag_lib->binding.tx          = NULL;
-    p_defrag_lib->binding.pkt_size    = MCTP_BODY_SIZE(MCTP_USB_MSGQ_MAX_FRAME_SIZE) - 16;
+    p_defrag_lib->binding.pkt_size    = MCTP_USB_MSGQ_MAX_FRAME_SIZE - sizeof(struct mctp_pktbuf); /* A packet fills a frame */
     p_defrag_lib->binding.pkt_header  = 0;
     p_defrag_lib->binding.pkt_trailer = 0;
+    p_defrag_lib->binding.tx_gather   = false;
+    p_defrag_lib->binding.tx_batch    = NULL;
+
+    /* Packet pool, created by libmctp when the bus is registered */
+    p_defrag_lib->binding.pkt_pool_count = MCTP_USB_MSGQ_ALLOCATED_FRAMES;
+    p_defrag_lib->binding.pkt_pool       = 0;
 
     ret = mctp_register_bus(p_defrag_lib->p_mctp, &p_defrag_lib->binding, p_defrag_lib->eid);
+    if ( ret == 0 )
+        mctp_binding_set_tx_enabled(&p_defrag_lib->binding, true);
+
     return ret;
 }
@@ -20,6 +20,7 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <hal_llist.h>
 #include <ncsi.h>
 #include <test_frag,h>
@@ -138,7 +139,7 @@ static int test_frag_calculate_ncsi_fragments(void)
         /* Drop the packet, it's too big */
         p_frag_test->ncsi_expected_frags_count = 0;
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
-        printf("\n\tError: NC-SI packet size results in too many fragments.\n");
+        hal_console_printf("\n\tError: NC-SI packet size results in too many fragments.\n");
 #endif
         return 1;
     }
@@ -237,15 +238,15 @@ static void test_frag_on_usb_tx(ptr_size_pair *pairs, size_t pairs_count)
 /* Implementation of USB transmission would go here. */
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
 
-    printf("\n\tUSB op. # %u:\n", p_frag_test->usb_tx_total_operations);
+    hal_console_printf("\n\tUSB op. # %u:\n", p_frag_test->usb_tx_total_operations);
 
     for ( int i = 0; i < pairs_count; i++ )
     {
-        printf("\n");
-        hal_hexdump((void *) pairs[i].ptr, pairs[i].size, false, "\t");
+        hal_console_printf("\n");
+        hal_console_hexdump((void *) pairs[i].ptr, pairs[i].size, false, "\t");
         p_frag_test->usb_raw_payload += pairs[i].size;
     }
-    printf("\n");
+    hal_console_printf("\n");
 
 #endif
 
@@ -350,7 +351,7 @@ void test_exec_frag(uintptr_t arg)
             p_frag_test->usb_tx_operation_bytes = 0;
 
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
-            printf("\n");
+            hal_console_printf("\n");
             p_frag_test->usb_tx_total_operations++;
             p_frag_test->usb_tx_operation_pointers = 0;
 #endif
@@ -371,7 +372,7 @@ void test_exec_frag(uintptr_t arg)
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
         p_frag_test->usb_tx_total_pointers += 2;
         p_frag_test->usb_tx_operation_pointers += 2;
-        printf("\tUSB adding TX pointer: size: %-3u, pointers %-2u\n", p_frag_test->usb_tx_operation_bytes, p_frag_test->usb_tx_operation_pointers);
+        hal_console_printf("\tUSB adding TX pointer: size: %-3u, pointers %-2u\n", p_frag_test->usb_tx_operation_bytes, p_frag_test->usb_tx_operation_pointers);
 #endif
 
         /* Move to the next fragment */
@@ -385,14 +386,14 @@ void test_exec_frag(uintptr_t arg)
         test_frag_on_usb_tx(p_frag_test->pairs, pairs_count);
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
         p_frag_test->usb_tx_total_operations++;
-        printf("\n");
+        hal_console_printf("\n");
 #endif
     }
 
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
-    printf("\n\n\tUSB total pointers: %d\n", p_frag_test->usb_tx_total_pointers);
-    printf("\tUSB total TX operations: %d\n", p_frag_test->usb_tx_total_operations);
-    printf("\tUSB total TX bytes: %d\n\n", p_frag_test->usb_raw_payload);
+    hal_console_printf("\n\n\tUSB total pointers: %d\n", p_frag_test->usb_tx_total_pointers);
+    hal_console_printf("\tUSB total TX operations: %d\n", p_frag_test->usb_tx_total_operations);
+    hal_console_printf("\tUSB total TX bytes: %d\n\n", p_frag_test->usb_raw_payload);
 #endif
 }
 
@@ -450,15 +451,15 @@ int test_frag_prologue(uintptr_t arg)
         /* Drop the packet , it's too big */
         p_frag_test->ncsi_expected_frags_count = 0;
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
-        printf("\n\tError: NC-`SI packet size results in too many fragments.\n");
+        hal_console_printf("\n\tError: NC-`SI packet size results in too many fragments.\n");
 #endif
         return 1;
     }
 
 #if defined(DEBUG) && (TEST_CONTINUOUS_MODE == 0)
-    printf("\n\tNC-SI inbound packet size: %d\n", p_frag_test->ncsi_packet_size);
-    printf("\tNC-SI expected fragments of up-to %d bytes: %d\n", MCTP_MAX_FRAGMNET_SIZE, p_frag_test->ncsi_expected_frags_count);
-    printf("\tExpected transmision: %u bytes.\n\n", p_frag_test->expected_tx_size);
+    hal_console_printf("\n\tNC-SI inbound packet size: %d\n", p_frag_test->ncsi_packet_size);
+    hal_console_printf("\tNC-SI expected fragments of up-to %d bytes: %d\n", MCTP_MAX_FRAGMNET_SIZE, p_frag_test->ncsi_expected_frags_count);
+    hal_console_printf("\tExpected transmision: %u bytes.\n\n", p_frag_test->expected_tx_size);
 #endif
 
     return 0; /* NC-SI packet reday for frgmantation */
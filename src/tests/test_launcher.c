@@ -19,6 +19,7 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
 #include <hal_llist.h>
 #include <test_launcher.h>
 #include <string.h>
@@ -180,7 +181,7 @@ uint64_t test_launcher_execute(size_t test_index)
         {
             if ( item->item_info->init(item->item_info->init_arg) )
             {
-                printf("Launcher error: init() function failed.\n");
+                hal_console_printf("Launcher error: init() function failed.\n");
                 break;
             }
         }
@@ -190,7 +191,7 @@ uint64_t test_launcher_execute(size_t test_index)
         {
             if ( item->item_info->prologue(item->item_info->prologue_arg) )
             {
-                printf("Launcher error: prologue() function failed.\n");
+                hal_console_printf("Launcher error: prologue() function failed.\n");
                 break;
             }
         }
@@ -206,7 +207,7 @@ uint64_t test_launcher_execute(size_t test_index)
         {
             if ( item->item_info->epilogue(item->item_info->epilogue_arg) )
             {
-                printf("Launcher error: epilogue() function failed.\n");
+                hal_console_printf("Launcher error: epilogue() function failed.\n");
                 break;
             }
         }
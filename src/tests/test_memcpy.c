@@ -18,8 +18,104 @@
   */
 
 #include <hal.h>
+#include <hal_console.h>
+#include <ncsi.h>
+#include <libmctp.h>
 #include <string.h>
 
+/* Constant size copy sites, see test_copy_const_epilog() */
+typedef struct test_copy_site_t
+{
+    const char * name;        /**< Call site name */
+    hal_sim_func generic;     /**< Original code: memcpy() or field by field stores */
+    hal_sim_func const_copy;  /**< HAL_COPY_CONST() based code */
+    size_t       offset;      /**< Destination offset in the scratch buffers */
+    size_t       size;        /**< Bytes produced by the site */
+
+} test_copy_site;
+
+/* Scratch destinations, laid out as in a real NC-SI packet */
+static ncsi_eth_packet test_copy_dst[2] __attribute__((aligned(4)));
+
+/* Templates used by the constant size variants */
+static const ethernet_header test_copy_eth_template __attribute__((aligned(4))) = {
+    .dest_mac  = {0x00, 0x25, 0x90, 0xAB, 0xCD, 0xEF},
+    .src_mac   = {0x00, 0x14, 0x22, 0x01, 0x23, 0x45},
+    .ethertype = 0xF888,
+};
+
+static const ncsi_packet test_copy_ncsi_template __attribute__((aligned(4))) = {
+    .mc_id = 0xA5, .command = 0x01, .channel_id = 0x02, .reserved = 0x03, .payload_length = 0xDC05, .reserved2 = 0x5A};
+
+static const struct mctp_hdr test_copy_mctp_template __attribute__((aligned(4))) = {.ver = 0x01, .dest = 0x09, .src = 0x08, .flags_seq_tag = 0xC8};
+
+/* clang-format off */
+static void test_copy_eth_generic(uintptr_t arg)
+{
+    ncsi_eth_packet *p = (ncsi_eth_packet *) arg;
+    uint8_t dest_mac[6] = {0x00, 0x25, 0x90, 0xAB, 0xCD, 0xEF};
+    uint8_t src_mac[6]  = {0x00, 0x14, 0x22, 0x01, 0x23, 0x45};
+
+    memcpy(p->eth_header.dest_mac, dest_mac, 6);
+    memcpy(p->eth_header.src_mac, src_mac, 6);
+    p->eth_header.ethertype = 0xF888;
+}
+
+static void test_copy_eth_const(uintptr_t arg)
+{
+    HAL_COPY_CONST_ALIGNED(&((ncsi_eth_packet *) arg)->eth_header, &test_copy_eth_template, 14, 4);
+}
+
+static void test_copy_mac_generic(uintptr_t arg)
+{
+    memcpy(((ncsi_eth_packet *) arg)->eth_header.src_mac, test_copy_eth_template.src_mac, 6);
+}
+
+static void test_copy_mac_const(uintptr_t arg)
+{
+    HAL_COPY_CONST_ALIGNED(((ncsi_eth_packet *) arg)->eth_header.src_mac, test_copy_eth_template.src_mac, 6, 2);
+}
+
+static void test_copy_ncsi_generic(uintptr_t arg)
+{
+    ncsi_packet *p = &((ncsi_eth_packet *) arg)->ncsi_data;
+
+    p->mc_id          = 0xA5;
+    p->command        = 0x01;
+    p->channel_id     = 0x02;
+    p->reserved       = 0x03;
+    p->payload_length = 0xDC05;
+    p->reserved2      = 0x5A;
+}
+
+static void test_copy_ncsi_const(uintptr_t arg)
+{
+    HAL_COPY_CONST_ALIGNED(&((ncsi_eth_packet *) arg)->ncsi_data, &test_copy_ncsi_template, 8, 2);
+}
+
+static void test_copy_mctp_generic(uintptr_t arg)
+{
+    struct mctp_hdr *hdr = (struct mctp_hdr *) ((ncsi_eth_packet *) arg)->ncsi_data.payload;
+
+    hdr->ver           = 0x01;
+    hdr->dest          = 0x09;
+    hdr->src           = 0x08;
+    hdr->flags_seq_tag = 0xC8;
+}
+
+static void test_copy_mctp_const(uintptr_t arg)
+{
+    HAL_COPY_CONST(((ncsi_eth_packet *) arg)->ncsi_data.payload, &test_copy_mctp_template, 4);
+}
+
+static const test_copy_site test_copy_sites[] = {
+    {"Ethernet header (14)", test_copy_eth_generic,  test_copy_eth_const,  offsetof(ncsi_eth_packet, eth_header),         sizeof(ethernet_header)},
+    {"Source MAC (6)",       test_copy_mac_generic,  test_copy_mac_const,  offsetof(ncsi_eth_packet, eth_header.src_mac), 6},
+    {"NC-SI header (8)",     test_copy_ncsi_generic, test_copy_ncsi_const, offsetof(ncsi_eth_packet, ncsi_data),          sizeof(ncsi_packet)},
+    {"MCTP header (4)",      test_copy_mctp_generic, test_copy_mctp_const, offsetof(ncsi_eth_packet, ncsi_data.payload),  sizeof(struct mctp_hdr)},
+};
+/* clang-format on */
+
 /**
  * @brief Measures the number of cycles spent on memory copying operations.
  * @param use_hal If 1, the function will use `hal_memcpy()`. Otherwise, it 
@@ -90,4 +186,76 @@ char *test_memcpy_desc_hal(size_t description_type)
                "highlight the advantages of a carefully tuned memcpy for specific use cases, \n"
                "with an emphasis on optimizing performance for small memory operations.\n";
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Executes all the constant size copy sites.
+ * @param arg Unused.
+ */
+
+void test_exec_copy_const(uintptr_t arg)
+{
+    for ( size_t i = 0; i < ARRAY_SIZE(test_copy_sites); i++ ) test_copy_sites[i].const_copy((uintptr_t) &test_copy_dst[1]);
+}
+
+/**
+ * @brief Measures each copy site both ways and reports the cycles delta.
+ *
+ * Each site is executed once using the original code and once using
+ * HAL_COPY_CONST(), the produced bytes are compared to make sure both
+ * variants are equivalent.
+ *
+ * @param arg Unused.
+ * @return 0 on success, 1 if any of the sites produced different bytes.
+ */
+
+int test_copy_const_epilog(uintptr_t arg)
+{
+    uint64_t generic_cycles, const_cycles;
+    int      ret = 0;
+
+    hal_console_printf("%-22s %8s %8s %8s\n", "Site", "Generic", "Const", "Delta");
+
+    for ( size_t i = 0; i < ARRAY_SIZE(test_copy_sites); i++ )
+    {
+        const test_copy_site *site = &test_copy_sites[i];
+
+        hal_zero_buf(test_copy_dst, sizeof(test_copy_dst));
+
+        generic_cycles = hal_measure_cycles(site->generic, (uintptr_t) &test_copy_dst[0]);
+        const_cycles   = hal_measure_cycles(site->const_copy, (uintptr_t) &test_copy_dst[1]);
+
+        if ( memcmp((uint8_t *) &test_copy_dst[0] + site->offset, (uint8_t *) &test_copy_dst[1] + site->offset, site->size) != 0 )
+        {
+            hal_console_printf("Error: '%s' copies differ.\n", site->name);
+            ret = 1;
+        }
+
+        hal_console_printf("%-22s %8llu %8llu %8lld\n", site->name, generic_cycles, const_cycles, (long long) (const_cycles - generic_cycles));
+    }
+
+    return ret;
+}
+
+/**
+ * @brief Provides a description for the constant size copy test.
+ * @param description_type 0 for a brief one-line description, 1 for an
+ *                         in-depth test description.
+ * @return A pointer to a string containing the description.
+ */
+
+char *test_copy_const_desc(size_t description_type)
+{
+    if ( description_type == 0 )
+    {
+        return "Constant size header copies (HAL_COPY_CONST).";
+    }
+    else
+    {
+        return "This test measures the protocol header copy sites (Ethernet, MAC, \n"
+               "NC-SI and MCTP headers) using HAL_COPY_CONST(), which expands to a \n"
+               "fixed sequence of word moves for each size. The epilogue measures \n"
+               "every site using both the original memcpy() / field by field code \n"
+               "and the constant size copy, and reports the per site cycles delta.\n";
+    }
+}